@@ -16,3 +16,153 @@
 
 #include "BriandCNN.hxx"
 
+using namespace std;
+using namespace Briand;
+
+Conv1D::Conv1D(const size_t& inputChannels, const size_t& kernelSize, const size_t& dilation, const ActivationFunction& activation, const Matrix& weights, const vector<double>& bias /* = {} */) {
+    // Check
+    if (inputChannels == 0 || kernelSize == 0 || dilation == 0) throw out_of_range("Conv1D: input channels, kernel size and dilation must be > 0.");
+    if (weights.Cols() != kernelSize * inputChannels) throw out_of_range("Conv1D: weight matrix cols must be kernel size * input channels.");
+    if (!bias.empty() && bias.size() != weights.Rows()) throw out_of_range("Conv1D: bias size must be equal to output channels.");
+
+    this->_inputChannels = inputChannels;
+    this->_kernelSize = kernelSize;
+    this->_dilation = dilation;
+    this->_activation = activation;
+    this->_weights = make_unique<Matrix>(weights);
+    this->_bias = bias;
+    if (this->_bias.empty()) this->_bias.assign(weights.Rows(), 0.0);
+
+    // History ring covers the receptive field
+    size_t rows = 1;
+    while (rows < this->ReceptiveField()) rows <<= 1;
+    this->_history.assign(rows * inputChannels, 0.0);
+    this->_historyMask = rows - 1;
+    this->_taps.resize(kernelSize * inputChannels);
+    this->_count = 0;
+}
+
+Conv1D::Conv1D(const size_t& inputChannels, const size_t& outputChannels, const size_t& kernelSize, const size_t& dilation, const ActivationFunction& activation, const uint64_t& seed, const WeightInit& init /* = WeightInit::Auto */) 
+    : Conv1D(inputChannels, kernelSize, dilation, activation, Matrix(static_cast<int>(outputChannels), static_cast<int>(kernelSize * inputChannels)))
+{
+    this->_weights->RandomizeWeights(init, activation, kernelSize * inputChannels, outputChannels, seed);
+}
+
+unique_ptr<Matrix> Conv1D::Forward(const Matrix& input) {
+    BRIAND_TRACE_SCOPE("Conv1D::Forward");
+
+    // Check
+    if (input.Cols() != this->_inputChannels) throw out_of_range("Conv1D: input cols must be equal to input channels.");
+
+    const size_t steps = input.Rows();
+    auto output = make_unique<Matrix>(static_cast<int>(steps), static_cast<int>(this->OutputChannels()));
+
+    for (size_t t = 0; t < steps; t++) {
+        // Gather the taps (zeros before the first timestep), newest tap last
+        for (size_t k = 0; k < this->_kernelSize; k++) {
+            const size_t back = (this->_kernelSize - 1 - k) * this->_dilation;
+            double* tap = this->_taps.data() + k * this->_inputChannels;
+            if (back > t) std::fill_n(tap, this->_inputChannels, 0.0);
+            else std::copy_n(input[t - back], this->_inputChannels, tap);
+        }
+
+        this->_weights->MultiplyVectorActivate(this->_taps.data(), this->_bias.data(), this->_activation, (*output.get())[t]);
+    }
+
+    return std::move(output);
+}
+
+void Conv1D::Step(const double* x, double* y) {
+    // Store the new input
+    const size_t rows = this->_historyMask + 1;
+    std::copy_n(x, this->_inputChannels, this->_history.data() + static_cast<size_t>(this->_count & this->_historyMask) * this->_inputChannels);
+
+    // Gather the taps from the ring (older than the first input are zeros: the ring starts cleared and is never read beyond it)
+    for (size_t k = 0; k < this->_kernelSize; k++) {
+        const size_t back = (this->_kernelSize - 1 - k) * this->_dilation;
+        const size_t row = static_cast<size_t>((this->_count + rows - back) & this->_historyMask);
+        std::copy_n(this->_history.data() + row * this->_inputChannels, this->_inputChannels, this->_taps.data() + k * this->_inputChannels);
+    }
+
+    this->_weights->MultiplyVectorActivate(this->_taps.data(), this->_bias.data(), this->_activation, y);
+    this->_count++;
+}
+
+void Conv1D::Reset() {
+    std::fill(this->_history.begin(), this->_history.end(), 0.0);
+    this->_count = 0;
+}
+
+size_t Conv1D::MemoryUsage() const {
+    size_t bytes = sizeof(Conv1D);
+    bytes += this->_weights->MemoryUsage();
+    bytes += (this->_bias.capacity() + this->_history.capacity() + this->_taps.capacity()) * sizeof(double);
+    return bytes;
+}
+
+Conv1DNetwork::Conv1DNetwork(const size_t& inputChannels) {
+    // Check
+    if (inputChannels == 0) throw out_of_range("Conv1DNetwork: input channels must be > 0.");
+
+    this->_inputChannels = inputChannels;
+    this->_seed = 0;
+}
+
+void Conv1DNetwork::SetSeed(const uint64_t& seed) {
+    this->_seed = seed;
+}
+
+void Conv1DNetwork::AddLayer(const size_t& outputChannels, const size_t& kernelSize, const size_t& dilation, const ActivationFunction& activation, const WeightInit& init /* = WeightInit::Auto */) {
+    // Each layer has its own seed, as FCNN
+    this->AddLayer(make_unique<Conv1D>(this->OutputChannels(), outputChannels, kernelSize, dilation, activation, this->_seed + this->_layers.size() + 1, init));
+}
+
+void Conv1DNetwork::AddLayer(unique_ptr<Conv1D> layer) {
+    // Check
+    if (layer == nullptr) throw runtime_error("Conv1DNetwork: null layer.");
+    if (layer->InputChannels() != this->OutputChannels()) throw out_of_range("Conv1DNetwork: layer input channels must be equal to the previous output channels.");
+
+    this->_activations.push_back(vector<double>(layer->OutputChannels()));
+    this->_layers.push_back(std::move(layer));
+}
+
+size_t Conv1DNetwork::OutputChannels() const {
+    return (this->_layers.empty() ? this->_inputChannels : this->_layers.back()->OutputChannels());
+}
+
+size_t Conv1DNetwork::ReceptiveField() const {
+    size_t field = 1;
+    for (auto& l : this->_layers) field += l->ReceptiveField() - 1;
+    return field;
+}
+
+unique_ptr<Matrix> Conv1DNetwork::Forward(const Matrix& input) {
+    // Check
+    if (this->_layers.empty()) throw runtime_error("Conv1DNetwork: no layers.");
+
+    auto x = this->_layers.front()->Forward(input);
+    for (size_t k = 1; k < this->_layers.size(); k++) x = this->_layers[k]->Forward(*x.get());
+    return x;
+}
+
+const vector<double>& Conv1DNetwork::Step(const double* x) {
+    // Check
+    if (this->_layers.empty()) throw runtime_error("Conv1DNetwork: no layers.");
+
+    const double* in = x;
+    for (size_t k = 0; k < this->_layers.size(); k++) {
+        this->_layers[k]->Step(in, this->_activations[k].data());
+        in = this->_activations[k].data();
+    }
+    return this->_activations.back();
+}
+
+void Conv1DNetwork::Reset() {
+    for (auto& l : this->_layers) l->Reset();
+}
+
+size_t Conv1DNetwork::MemoryUsage() const {
+    size_t bytes = sizeof(Conv1DNetwork);
+    for (size_t k = 0; k < this->_layers.size(); k++) bytes += this->_layers[k]->MemoryUsage() + this->_activations[k].capacity() * sizeof(double);
+    return bytes;
+}
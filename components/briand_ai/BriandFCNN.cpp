@@ -18,6 +18,7 @@
 
 using namespace std;
 using namespace Briand;
+using namespace Briand::Expression;
 
 /**********************************************************************
     Neural Layer class
@@ -30,14 +31,21 @@ NeuralLayer::NeuralLayer(const LayerType& type, const size_t& neurons, Activatio
     if (type != LayerType::Input && (f == nullptr || df == nullptr)) throw runtime_error("Must specify f and df for non-input layers!");
     if (type == LayerType::Output && e == nullptr) throw runtime_error("Must specify cost/error calculation for output layer!");
     if (type != LayerType::Output && e != nullptr) throw runtime_error("Cannot specify cost/error calculation for non-output layers!");
+    if (f == Math::Softmax && type != LayerType::Output) throw runtime_error("Softmax is allowed only for the output layer!");
+    if (f == Math::Softmax && e != Math::CrossEntropy) throw runtime_error("Softmax output layer requires CrossEntropy error!");
 
     // Initialize
     this->_f = f;
     this->_df = df;
+    this->_dfOut = (df != nullptr ? Math::DerivativeFromOutput(df) : nullptr);
     this->_E = e;
     this->_dE = de;
     this->_type = type;
+    this->_softmax = (f == Math::Softmax);
     this->_weights = nullptr;
+    this->_sparseWeights = nullptr;
+    this->_useSparse = false;
+    this->_halfWeights = nullptr;
     this->_delta = nullptr;
 
     // Bias neuron value is always 1 so just handle the weights (FCN)
@@ -81,6 +89,9 @@ NeuralLayer::NeuralLayer(const LayerType& type, const size_t& neurons, Activatio
 
 NeuralLayer::~NeuralLayer() {
     this->_weights.reset();
+    this->_sparseWeights.reset();
+    this->_halfWeights.reset();
+    this->_fakeWeights.reset();
     this->_neuronsNet.reset();
     this->_neuronsOut.reset();
     this->_delta.reset();
@@ -99,6 +110,17 @@ void NeuralLayer::SetBiasWeights(const vector<double>& bias_weights) {
 
 FCNN::FCNN() {
     this->_hasOutputs = false;
+    this->_seed = Random::GlobalSeed();
+    this->_incremental = false;
+    this->_incrementalThreshold = 0.25;
+    this->_incrementalResync = 1000;
+    this->_incrementalCount = 0;
+    this->_incrementalValid = false;
+    this->_previousInput = nullptr;
+    this->_backpropagated = make_unique<vector<double>>();
+    this->_quantizationAware = false;
+    this->_quantizationMomentum = 0.99;
+    this->_quantizationObserve = false;
     this->_layers = make_unique<vector<unique_ptr<NeuralLayer>>>();
 }
 
@@ -106,6 +128,33 @@ FCNN::~FCNN() {
     this->_layers.reset();
 }
 
+void FCNN::SetSeed(const uint64_t& seed) {
+    this->_seed = seed;
+}
+
+unique_ptr<Matrix> FCNN::InitialWeights(const size_t& rows, const size_t& cols, const ActivationFunction& activationFunc, const WeightInit& init) {
+    auto weights = make_unique<Matrix>(rows, cols);
+
+    // Each layer has its own seed, so weights do not depend on the previous layers size
+    const uint64_t seed = this->_seed + this->_layers->size();
+
+    weights->RandomizeWeights(init, activationFunc, cols, rows, seed);
+
+    return weights;
+}
+
+void FCNN::FoldInputBias() {
+    const auto& input = this->_layers->at(0);
+    if (input->_bias_weights == nullptr || this->_layers->size() < 2) return;
+
+    // W_1 * (x + b_in) + b_1 = W_1 * x + (b_1 + W_1 * b_in)
+    const auto& first = this->_layers->at(1);
+    if (first->_bias_weights == nullptr) first->_bias_weights = make_unique<vector<double>>(first->_neuronsOut->size(), 0.0);
+    Assign(*first->_bias_weights.get(), Ref(*first->_bias_weights.get()) + Ref(*first->_weights.get()) * Ref(*input->_bias_weights.get()));
+
+    input->_bias_weights.reset();
+}
+
 void FCNN::AddInputLayer(const size_t& inputs) {
     // Check
     if (this->_layers->size() > 0) throw runtime_error("Input layer has been added before.");
@@ -125,26 +174,29 @@ void FCNN::AddInputLayer(const size_t& inputs, const vector<double>& values) {
 }
 
 void FCNN::SetInput(const vector<double>& values) {
+    this->SetInput(values.data(), values.size());
+}
+
+void FCNN::SetInput(const double* values, const size_t& size) {
     // Check
     if (this->_layers == nullptr || this->_layers->size() < 1) throw runtime_error("Cannot set input values: missing input layer.");
-    if (values.size() != this->_layers->at(0)->_neuronsOut->size()) throw runtime_error("Input values: invalid size.");
+    if (size != this->_layers->at(0)->_neuronsOut->size()) throw runtime_error("Input values: invalid size.");
 
     for (int i = 0; i<this->_layers->at(0)->_neuronsOut->size(); i++) this->_layers->at(0)->_neuronsOut->at(i) = values[i];
 }
 
-void FCNN::AddHiddenLayer(const size_t& neurons, const ActivationFunction& activationFunc, const ActivationFunction& activationDer) {
+void FCNN::AddHiddenLayer(const size_t& neurons, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const WeightInit& init /* = WeightInit::Auto */) {
     // Check
     if (this->_layers == nullptr || this->_layers->size() < 1) throw runtime_error("Cannot add hidden layer: missing an input layer.");
     if (this->_hasOutputs) throw runtime_error("Cannot add hidden layer after output layer!");
 
     // Default weights matrix with random values, as many rows as neurons, as many columns as previous layer neurons.
-    const int rows = neurons;
-    const int cols = this->_layers->at(this->_layers->size() - 1)->_neuronsOut->size();
+    const size_t rows = neurons;
+    const size_t cols = this->_layers->at(this->_layers->size() - 1)->_neuronsOut->size();
 
-    Matrix init{rows, cols};
-    init.Randomize();
+    auto weights = this->InitialWeights(rows, cols, activationFunc, init);
 
-    auto layer = make_unique<NeuralLayer>(LayerType::Hidden, neurons, activationFunc, activationDer, nullptr, nullptr, init);
+    auto layer = make_unique<NeuralLayer>(LayerType::Hidden, neurons, activationFunc, activationDer, nullptr, nullptr, *weights.get());
     this->_layers->push_back(std::move(layer));
 }
 
@@ -163,23 +215,25 @@ void FCNN::AddHiddenLayer(const size_t& neurons, const ActivationFunction& activ
     this->_layers->push_back(std::move(layer));
 }
 
-void FCNN::AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer) {
+void FCNN::AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer, const WeightInit& init /* = WeightInit::Auto */) {
     // Check
     if (this->_hasOutputs) throw runtime_error("Output layer has been added before.");
     if (this->_layers == nullptr || this->_layers->size() < 1) throw runtime_error("Cannot add output layer: missing an input layer.");
 
     // Default weights matrix with random values, as many rows as neurons, as many columns as previous layer neurons.
-    const int rows = outputs;
-    const int cols = this->_layers->at(this->_layers->size() - 1)->_neuronsOut->size();
+    const size_t rows = outputs;
+    const size_t cols = this->_layers->at(this->_layers->size() - 1)->_neuronsOut->size();
 
-    Matrix init{rows, cols};
-    init.Randomize();
+    auto weights = this->InitialWeights(rows, cols, activationFunc, init);
 
-    auto layer = make_unique<NeuralLayer>(LayerType::Output, outputs, activationFunc, activationDer, errorFunc, errorFuncDer, init);
+    auto layer = make_unique<NeuralLayer>(LayerType::Output, outputs, activationFunc, activationDer, errorFunc, errorFuncDer, *weights.get());
     this->_layers->push_back(std::move(layer));
 
     // Close network build
     this->_hasOutputs = true;
+
+    // Input bias constant folding
+    this->FoldInputBias();
 }
 
 void FCNN::AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer, const Matrix& weights) {
@@ -199,14 +253,77 @@ void FCNN::AddOutputLayer(const size_t& outputs, const ActivationFunction& activ
 
     // Close network build
     this->_hasOutputs = true;
+
+    // Input bias constant folding
+    this->FoldInputBias();
+}
+
+void FCNN::EnableIncremental(const double& threshold /* = 0.25 */, const size_t& resyncInterval /* = 1000 */) {
+    // Check
+    if (threshold < 0.0 || threshold > 1.0) throw out_of_range("Incremental threshold must be between 0 and 1.");
+
+    this->_incremental = true;
+    this->_incrementalThreshold = threshold;
+    this->_incrementalResync = resyncInterval;
+    this->_incrementalValid = false;
+}
+
+void FCNN::DisableIncremental() {
+    this->_incremental = false;
+    this->_incrementalValid = false;
+    this->_previousInput.reset();
+}
+
+bool FCNN::PropagateFirstLayerIncremental() {
+    const auto& x = *this->_layers->at(0)->_neuronsOut.get();
+    const auto& l = this->_layers->at(1);
+
+    if (!this->_incrementalValid || this->_previousInput == nullptr) return false;
+    if (l->_halfWeights != nullptr) return false;
+    if (this->_incrementalResync > 0 && this->_incrementalCount >= this->_incrementalResync) return false;
+
+    // Changed inputs
+    auto& previous = *this->_previousInput.get();
+    const size_t limit = static_cast<size_t>(this->_incrementalThreshold * static_cast<double>(x.size()));
+    size_t changed = 0;
+    for (size_t j = 0; j < x.size(); j++) if (x[j] != previous[j] && ++changed > limit) return false;
+
+    // Column updates: z += W[:,j] * dx_j
+    const auto& W = *l->_weights.get();
+    double* net = l->_neuronsNet->data();
+    for (size_t j = 0; j < x.size() && changed > 0; j++) {
+        if (x[j] == previous[j]) continue;
+        const double dx = x[j] - previous[j];
+        for (size_t i = 0; i < W.Rows(); i++) net[i] += W[i][j] * dx;
+        previous[j] = x[j];
+        changed--;
+    }
+
+    double* out = l->_neuronsOut->data();
+    const auto f = l->Elementwise();
+    for (size_t i = 0; i < W.Rows(); i++) out[i] = f(net[i]);
+    l->Normalize(out);
+
+    this->_incrementalCount++;
+    return true;
 }
 
 void FCNN::Propagate() {
+    BRIAND_TRACE_SCOPE("FCNN::Propagate");
+
     // Check
     if (this->_layers == nullptr || this->_layers->size() < 1) throw runtime_error("Cannot propagate: missing an input layer.");
     if (!this->_hasOutputs) throw runtime_error("Cannot propagate: missing an output layer.");
     if (this->_layers == nullptr || this->_layers->size() < 2) throw runtime_error("Cannot propagate with less than 2 layers!");
 
+    // Input bias is folded into the first layer when the network is closed
+    if (this->_layers->at(0)->_bias_weights != nullptr) this->FoldInputBias();
+
+    if (this->_quantizationAware) {
+        this->PropagateQuantizationAware();
+        return;
+    }
+
     // Weighted sum calculation, starting from the first layer after input.
     for (auto it = this->_layers->begin() + 1; it != this->_layers->end(); it++) {
         // Previous layer l-1
@@ -214,37 +331,53 @@ void FCNN::Propagate() {
         // Current layer a_(l)
         const auto& l = it->get();
 
-        // If the previous layer is the input layer, separate calculus to add bias
-        // (backpropagating would drive to wrong input value if iterated)
+        BRIAND_TRACE_SCOPE_ARG("Propagate layer", static_cast<long>(it - this->_layers->begin()));
+
+        const auto& x = *l_1->_neuronsOut.get();
 
-        if (l_1->_type == LayerType::Input && l_1->_bias_weights != nullptr && l_1->_bias_weights->size() > 0) {
-            // copy values
-            vector<double> a_l_1;
-            a_l_1.assign(l_1->_neuronsOut->begin(), l_1->_neuronsOut->end()); 
-            // add biasing
-            for (size_t i = 0; i<a_l_1.size(); i++) a_l_1[i] += l_1->_bias_weights->at(i);
+        if (this->_incremental && l_1->_type == LayerType::Input) {
+            if (this->PropagateFirstLayerIncremental()) continue;
+
+            // Full recompute below, save the input it is computed from
+            if (this->_previousInput == nullptr) this->_previousInput = make_unique<vector<double>>();
+            this->_previousInput->assign(x.begin(), x.end());
+            this->_incrementalCount = 0;
+            this->_incrementalValid = true;
+        }
 
-            // Weighted sum can be performed with weight_matrix * vector
-            // In math: z_(l) = W_(l) * a_(l-1)
-            l->_neuronsNet = l->_weights->MultiplyVector(a_l_1);
+        if (l->_halfWeights != nullptr) {
+            l->_halfWeights->MultiplyVector(x.data(), l->_neuronsNet->data());
+
+            // Add the bias (1*b_i) and activate: a_l = f(z_l)
+            double* net = l->_neuronsNet->data();
+            double* out = l->_neuronsOut->data();
+            const double* b = (l->_bias_weights != nullptr ? l->_bias_weights->data() : nullptr);
+            const auto f = l->Elementwise();
+            for (size_t i = 0; i < l->_neuronsNet->size(); i++) {
+                if (b != nullptr) net[i] += b[i];
+                out[i] = f(net[i]);
+            }
+        }
+        else if (l->_useSparse) {
+            l->_sparseWeights->MultiplyVector(x.data(), l->_neuronsNet->data());
+
+            // Add the bias (1*b_i) and activate: a_l = f(z_l)
+            double* net = l->_neuronsNet->data();
+            double* out = l->_neuronsOut->data();
+            const double* b = (l->_bias_weights != nullptr ? l->_bias_weights->data() : nullptr);
+            const auto f = l->Elementwise();
+            for (size_t i = 0; i < l->_neuronsNet->size(); i++) {
+                if (b != nullptr) net[i] += b[i];
+                out[i] = f(net[i]);
+            }
         }
         else {
-            // Direct, save memory
-            
-            // Weighted sum can be performed with weight_matrix * vector
-            // In math: z_(l) = W_(l) * a_(l-1)
-            l->_neuronsNet = l->_weights->MultiplyVector(*l_1->_neuronsOut.get());
-        }    
-
-        // Now activate neurons applying the activation function of this layer
-        // In math a_l = f(z_l)
-        for (int i = 0; i< l->_neuronsNet->size(); i++) {
-            // If current layer has a bias, add the weighted value (1*b_i) to each neuron
-            if (l->_bias_weights != nullptr) l->_neuronsNet->at(i) += l->_bias_weights->at(i);
-            
-            // Activate
-            l->_neuronsOut->at(i) = l->_f( l->_neuronsNet->at(i) );
+            // In math: z_l = W_l * a_(l-1) + b_l and a_l = f(z_l), in a single pass over each weight row
+            l->_weights->MultiplyVectorActivate(x, l->_bias_weights.get(), l->Elementwise(), *l->_neuronsNet.get(), *l->_neuronsOut.get());
         }
+
+        // Softmax output: normalize over the layer
+        l->Normalize(l->_neuronsOut->data());
     }
 }
 
@@ -268,52 +401,98 @@ unique_ptr<vector<double>> FCNN::Predict(const vector<double>& inputs) {
     return this->GetResult();
 }
 
+unique_ptr<ExecutionContext> FCNN::CreateContext() const {
+    size_t widest = 0;
+    for (auto& l : *this->_layers.get()) widest = std::max(widest, l->_neuronsOut->size());
+    return make_unique<ExecutionContext>(widest);
+}
+
+unique_ptr<vector<double>> FCNN::Predict(const vector<double>& inputs, ExecutionContext& context) const {
+    return this->Predict(inputs.data(), inputs.size(), context);
+}
+
+unique_ptr<vector<double>> FCNN::Predict(const double* inputs, const size_t& size, ExecutionContext& context) const {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot predict: missing an output layer.");
+
+    auto result = make_unique<vector<double>>(this->_layers->back()->_neuronsOut->size());
+    this->Predict(inputs, size, result->data(), context);
+
+    return std::move(result);
+}
+
+void FCNN::Predict(const double* inputs, const size_t& size, double* outputs, ExecutionContext& context) const {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot predict: missing an output layer.");
+    if (size != this->_layers->at(0)->_neuronsOut->size()) throw runtime_error("Input values: invalid size.");
+    if (this->_layers->at(0)->_bias_weights != nullptr) throw runtime_error("Cannot predict with context: input bias not folded.");
+
+    // Buffers must not be reallocated during the pass
+    size_t widest = 0;
+    for (auto& l : *this->_layers.get()) widest = std::max(widest, l->_neuronsOut->size());
+    context.Reserve(widest);
+
+    const double* x = inputs;
+
+    for (size_t k = 1; k < this->_layers->size(); k++) {
+        const auto& l = this->_layers->at(k);
+        const size_t n = l->_neuronsOut->size();
+
+        // Latest layer writes directly to the outputs, the others alternate the two context buffers
+        double* y = (k == this->_layers->size() - 1 ? outputs : context.Buffer(k));
+        const double* b = (l->_bias_weights != nullptr ? l->_bias_weights->data() : nullptr);
+
+        const auto f = l->Elementwise();
+        if (l->_halfWeights != nullptr || l->_useSparse) {
+            if (l->_halfWeights != nullptr) l->_halfWeights->MultiplyVector(x, y);
+            else l->_sparseWeights->MultiplyVector(x, y);
+            for (size_t i = 0; i < n; i++) y[i] = f(b != nullptr ? y[i] + b[i] : y[i]);
+        }
+        else l->_weights->MultiplyVectorActivate(x, b, f, y);
+        l->Normalize(y);
+
+        x = y;
+    }
+}
+
+size_t FCNN::Outputs() const {
+    return (this->_hasOutputs ? this->_layers->back()->_neuronsOut->size() : 0);
+}
+
 double FCNN::Train(const vector<double>& inputs, const vector<double>& targets, const double& learningRate) {
+    BRIAND_TRACE_SCOPE("FCNN::Train");
+
     // Check
     if (this->_layers == nullptr || this->_layers->size() < 1) throw runtime_error("Cannot backpropagate: missing an input layer.");
     if (!this->_hasOutputs) throw runtime_error("Cannot backpropagate: missing an output layer.");
     if (targets.size() != this->_layers->at(this->_layers->size() - 1)->_neuronsOut->size()) throw out_of_range("Invalid targets: size must be equal to outputs.");
+    this->RequireMasterWeights("train");
 
-    // Get results
-    auto outputs = this->Predict(inputs);
+    // Forward pass: outputs, activations and net values are read from the layers (no copies)
+    this->SetInput(inputs);
+    this->_quantizationObserve = this->_quantizationAware;
+    this->Propagate();
+    this->_quantizationObserve = false;
     const auto& outputLayer = this->_layers->at(this->_layers->size() - 1);
+    const auto& outputs = *outputLayer->_neuronsOut.get();
 
-#if BRIAND_AI_DEBUG
-    printf("\n\n    ------ TRAINING\n");
-    printf("\nx = \n");
-    Matrix::PrintVector(inputs);
-    printf("\ny = \n");
-    Matrix::PrintVector(*outputLayer->_neuronsOut.get());
-    printf("\ny^ = \n");
-    Matrix::PrintVector(targets);
-#endif
-
-    double totalError = 0;
-
-    // Calculate errors at output and total error. Save in J vector
-    auto J = make_unique<vector<double>>(targets);
-    for(size_t i = 0; i < J->size(); i++) {
-        J->at(i) = outputLayer->_E(targets[i], outputs->at(i)); 
-        totalError += J->at(i);
-    }
+    BRIAND_LOGD("BriandFCNN", "------ TRAINING");
+    BRIAND_LOGD_VECTOR("BriandFCNN", "x", inputs);
+    BRIAND_LOGD_VECTOR("BriandFCNN", "y", *outputLayer->_neuronsOut.get());
+    BRIAND_LOGD_VECTOR("BriandFCNN", "y^", targets);
 
-    // Calculate delta for output layer
-    outputLayer->_delta = make_unique<vector<double>>();  
-    for (size_t i = 0; i < outputLayer->_neuronsNet->size(); i++) {
-        // (y - y^)*df(z)
-        outputLayer->_delta->push_back( (outputs->at(i) - targets[i]) * outputLayer->_df(outputLayer->_neuronsNet->at(i)) );
-    }
+    // Total error at output
+    const double totalError = this->Loss(outputs, targets);
 
-#if BRIAND_AI_DEBUG
-    printf("\nTotal error = %.5f\n", totalError);
-    printf("\nJ = \n");
-    Matrix::PrintVector(*J.get());
-    printf("\ndelta_L = \n");
-    Matrix::PrintVector(*outputLayer->_delta.get());
-#endif
+    // Calculate delta for output layer: (y - y^)*df(z), or y - y^ for softmax with cross-entropy (the Jacobian cancels out).
+    // When possible df is taken from the activated values: no exp() or tanh() again.
+    if (outputLayer->_delta == nullptr) outputLayer->_delta = make_unique<vector<double>>();
+    if (outputLayer->_softmax) Assign(*outputLayer->_delta.get(), Ref(outputs) - Ref(targets));
+    else if (outputLayer->_dfOut != nullptr) Assign(*outputLayer->_delta.get(), Hadamard(Ref(outputs) - Ref(targets), Map(outputLayer->_dfOut, Ref(outputs))));
+    else Assign(*outputLayer->_delta.get(), Hadamard(Ref(outputs) - Ref(targets), Map(outputLayer->_df, Ref(*outputLayer->_neuronsNet.get()))));
 
-    // Destroy unecessary objects
-    J.reset();
+    BRIAND_LOGD("BriandFCNN", "Total error = %.5f", totalError);
+    BRIAND_LOGD_VECTOR("BriandFCNN", "delta_L", *outputLayer->_delta.get());
 
     // Backward iterate (until input is reached).
     for (size_t k = this->_layers->size() - 1; k >= 1; k--) {
@@ -328,58 +507,105 @@ double FCNN::Train(const vector<double>& inputs, const vector<double>& targets,
         // Current layer l
         const auto& l = this->_layers->at(k);
 
+        BRIAND_TRACE_SCOPE_ARG("Backpropagate layer", static_cast<long>(k));
+
         // Prev layer l-1
         const auto& l_prev = this->_layers->at(k-1);
 
-        // Vector-Vector product delta_l+1 by transposed output of layer l
-        // Here l = l+1 so l = l-1
-        auto m1 = Matrix::DotMultiplyVectors(*l->_delta.get(), *l_prev->_neuronsOut.get());
-
-        // Multiply all elements by learning rate
-        m1->MultiplyScalar(learningRate);
-
-#if BRIAND_AI_DEBUG
-        printf("\nUpdating W_%d(%d,%d) ; b(%d). Using m1(%d,%d) = delta(%d)*a_l-1(%d) where l = %d\n"
-            , k
-            , l->_weights->Rows()
-            , l->_weights->Cols()
-            , l->_type != LayerType::Output ? l->_bias_weights->size() : 0
-            , m1->Rows()
-            , m1->Cols()
-            , l->_delta->size()
-            , l_prev->_neuronsOut->size()
-            , k
+        const auto& delta = *l->_delta.get();
+        auto& W = *l->_weights.get();
+
+        // Propagate delta before updating weights: W_l_T dot delta_l (transposed view, W is read by rows and never copied).
+        // Not needed when l-1 is the input layer: it has no activation and its bias is folded into this layer's bias.
+        auto& temp = *this->_backpropagated.get();
+        if (l_prev->_type != LayerType::Input) {
+            temp.resize(W.Cols());
+            TransposedView(W).MultiplyVector(delta.data(), temp.data());
+        }
+
+        BRIAND_LOGD("BriandFCNN", "Updating W_%lu(%lu,%lu) ; b(%lu). Using delta(%lu)*a_l-1(%lu) where l = %lu"
+            , static_cast<unsigned long>(k)
+            , static_cast<unsigned long>(W.Rows())
+            , static_cast<unsigned long>(W.Cols())
+            , static_cast<unsigned long>(l->_bias_weights != nullptr ? l->_bias_weights->size() : 0)
+            , static_cast<unsigned long>(delta.size())
+            , static_cast<unsigned long>(l_prev->_neuronsOut->size())
+            , static_cast<unsigned long>(k)
         );
-#endif
 
         // Check
-        assert(m1->Rows() == l->_weights->Rows());
-        assert(m1->Cols() == l->_weights->Cols());
-        assert(l->_delta->size() == l_prev->_bias_weights->size());
-
-        // Update weights and bias at layer l
-        for (int i=0; i < l->_weights->Rows(); i++) {
-            for (int j=0; j < l->_weights->Cols(); j++) {
-                l->_weights->at(i,j) -= m1->at(i,j); 
-            }
-            
-            l_prev->_bias_weights->at(i) -= learningRate * l->_delta->at(i);
-        }
+        assert(l->_bias_weights == nullptr || delta.size() == l->_bias_weights->size());
+
+        // Update weights at layer l: W_l = W_l - lr * delta_l * a_(l-1)_T, in a single pass over W
+        Assign(W, Ref(W) - learningRate * Outer(Ref(delta), Ref(*l_prev->_neuronsOut.get())));
 
-        // Calculate new delta (from current layer) to be delta_(l+1) in next for cycle
-        // delta_l = ( Wl_T dot delta_l+1 ) *hadamard df(z_l)
-        auto Wl_T = l->_weights->Transpose();
-        auto temp = Wl_T->MultiplyVector(*l->_delta.get());
+        // Update bias at layer l
+        if (l->_bias_weights != nullptr) Assign(*l->_bias_weights.get(), Ref(*l->_bias_weights.get()) - learningRate * Ref(delta));
 
-        l_prev->_delta = make_unique<vector<double>>();
-        for (int i=0; i < l->_neuronsNet->size(); i++) {
-            l_prev->_delta->push_back( temp->at(i) * l->_df(l->_neuronsNet->at(i)) );
+        // Pruned layer: keep pruned weights to zero and update the sparse ones
+        if (l->_sparseWeights != nullptr) l->_sparseWeights->Reload(W);
+
+        // 16 bit storage: convert the updated master copy
+        if (l->_halfWeights != nullptr) l->_halfWeights->Reload(W);
+
+        // Calculate new delta (for layer l-1) to be delta_(l) in next for cycle
+        // delta_l-1 = ( Wl_T dot delta_l ) *hadamard df(z_l-1), with df(z_l-1) from a_l-1 when possible
+        if (l_prev->_type != LayerType::Input) {
+            if (l_prev->_delta == nullptr) l_prev->_delta = make_unique<vector<double>>();
+            if (l_prev->_dfOut != nullptr) Assign(*l_prev->_delta.get(), Hadamard(Ref(temp), Map(l_prev->_dfOut, Ref(*l_prev->_neuronsOut.get()))));
+            else Assign(*l_prev->_delta.get(), Hadamard(Ref(temp), Map(l_prev->_df, Ref(*l_prev->_neuronsNet.get()))));
         }
     }
 
+    // Weights changed, first layer net values are not valid for incremental propagation anymore
+    this->_incrementalValid = false;
+
     return totalError;
 }
 
+double FCNN::Loss(const vector<double>& outputs, const vector<double>& targets) const {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot calculate loss: missing an output layer.");
+    if (outputs.size() != targets.size()) throw out_of_range("Invalid targets: size must be equal to outputs.");
+
+    const auto& E = this->_layers->back()->_E;
+    double total = 0.0;
+    for (size_t i = 0; i < outputs.size(); i++) total += E(targets[i], outputs[i]);
+
+    return total;
+}
+
+void FCNN::Restore(const InferenceModel& model) {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot restore: missing an output layer.");
+    if (model.Layers().size() != this->_layers->size() - 1) throw out_of_range("Cannot restore: model has a different number of layers.");
+    this->RequireMasterWeights("restore");
+    for (size_t k = 1; k < this->_layers->size(); k++) {
+        const auto& m = model.Layers()[k-1];
+        const auto& W = *this->_layers->at(k)->_weights.get();
+        if (m.Outputs != W.Rows() || m.Inputs != W.Cols()) throw out_of_range("Cannot restore: model has a different layer size.");
+    }
+
+    for (size_t k = 1; k < this->_layers->size(); k++) {
+        const auto& m = model.Layers()[k-1];
+        const auto& l = this->_layers->at(k);
+
+        for (size_t i = 0; i < m.Outputs; i++) {
+            if (m.HalfWeights != nullptr) HalfMatrix::Decode(m.HalfWeights + i * m.Inputs, (*l->_weights.get())[i], m.Inputs, m.Storage);
+            else memcpy((*l->_weights.get())[i], m.Weights + i * m.Inputs, m.Inputs * sizeof(double));
+        }
+
+        if (m.Bias != nullptr) l->_bias_weights = make_unique<vector<double>>(m.Bias, m.Bias + m.Outputs);
+        else l->_bias_weights.reset();
+
+        // Pruned layer: pruned weights are zero in the model too
+        if (l->_sparseWeights != nullptr) l->_sparseWeights->Reload(*l->_weights.get());
+        if (l->_halfWeights != nullptr) l->_halfWeights->Reload(*l->_weights.get());
+    }
+
+    this->_incrementalValid = false;
+}
+
 void FCNN::PrintResult() {
     // Check
     if (!this->_hasOutputs) throw runtime_error("GetResult() Error: missing an output layer.");
@@ -394,3 +620,460 @@ void FCNN::PrintResult() {
     */
 }
 
+
+
+void FCNN::Prune(const double& sparsity) {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot prune: missing an output layer.");
+    this->RequireMasterWeights("prune");
+
+    this->_incrementalValid = false;
+
+    for (auto it = this->_layers->begin() + 1; it != this->_layers->end(); it++) {
+        const auto& l = it->get();
+
+        // Zero the smallest weights and build the sparse matrix (the pattern)
+        l->_weights->Prune(sparsity);
+        l->_sparseWeights = make_unique<SparseMatrix>(*l->_weights.get());
+        if (l->_halfWeights != nullptr) l->_halfWeights->Reload(*l->_weights.get());
+
+        // Choose the faster kernel for this layer's size and sparsity
+        vector<double> x(l->_weights->Cols(), 1.0);
+        const uint8_t RUNS = 5;
+
+        uint64_t start = esp_timer_get_time();
+        for (uint8_t i = 0; i < RUNS; i++) l->_weights->MultiplyVector(x);
+        uint64_t denseTime = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (uint8_t i = 0; i < RUNS; i++) l->_sparseWeights->MultiplyVector(x);
+        uint64_t sparseTime = esp_timer_get_time() - start;
+
+        l->_useSparse = (sparseTime < denseTime);
+
+        BRIAND_LOGD("BriandFCNN", "Pruned layer W(%lu,%lu): sparsity %.2lf, dense %luus, sparse %luus, using %s."
+            , static_cast<unsigned long>(l->_weights->Rows())
+            , static_cast<unsigned long>(l->_weights->Cols())
+            , l->_sparseWeights->Sparsity()
+            , static_cast<unsigned long>(denseTime)
+            , static_cast<unsigned long>(sparseTime)
+            , l->_useSparse ? "sparse" : "dense"
+        );
+    }
+}
+
+size_t FCNN::WeightsMemoryUsage() {
+    size_t bytes = 0;
+
+    for (auto it = this->_layers->begin(); it != this->_layers->end(); it++) {
+        const auto& l = it->get();
+        if (l->_weights != nullptr) bytes += l->_weights->MemoryUsage();
+        if (l->_sparseWeights != nullptr) bytes += l->_sparseWeights->MemoryUsage();
+        if (l->_halfWeights != nullptr) bytes += l->_halfWeights->MemoryUsage();
+        if (l->_bias_weights != nullptr) bytes += l->_bias_weights->size() * sizeof(double);
+    }
+
+    return bytes;
+}
+
+size_t FCNN::MemoryUsage() {
+    size_t bytes = sizeof(FCNN) + this->WeightsMemoryUsage();
+    bytes += this->_layers->capacity() * sizeof(unique_ptr<NeuralLayer>);
+
+    for (auto it = this->_layers->begin(); it != this->_layers->end(); it++) {
+        const auto& l = it->get();
+        bytes += sizeof(NeuralLayer);
+        if (l->_neuronsNet != nullptr) bytes += sizeof(vector<double>) + l->_neuronsNet->capacity() * sizeof(double);
+        if (l->_neuronsOut != nullptr) bytes += sizeof(vector<double>) + l->_neuronsOut->capacity() * sizeof(double);
+        if (l->_delta != nullptr) bytes += sizeof(vector<double>) + l->_delta->capacity() * sizeof(double);
+        if (l->_weights != nullptr) bytes += sizeof(Matrix);
+        if (l->_sparseWeights != nullptr) bytes += sizeof(SparseMatrix);
+        if (l->_halfWeights != nullptr) bytes += sizeof(HalfMatrix);
+        if (l->_bias_weights != nullptr) bytes += sizeof(vector<double>);
+    }
+
+    if (this->_backpropagated != nullptr) bytes += sizeof(vector<double>) + this->_backpropagated->capacity() * sizeof(double);
+
+    return bytes;
+}
+
+unique_ptr<InferenceModel> FCNN::Freeze() {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot freeze: missing an output layer.");
+    if (this->_layers->at(0)->_bias_weights != nullptr) this->FoldInputBias();
+
+    // Blob size
+    const size_t layers = this->_layers->size();
+    const auto shapes = this->LayerShapes();
+    size_t size = 1 + layers;
+    for (size_t k = 1; k < layers; k++) {
+        const auto& l = this->_layers->at(k);
+        const size_t weights = shapes[k-1].first * shapes[k-1].second;
+        size += 1 + (l->_halfWeights != nullptr ? (weights + 3) / 4 : weights) + (l->_bias_weights != nullptr ? l->_bias_weights->size() : 0);
+    }
+
+    auto blob = make_unique<double[]>(size);
+    vector<ActivationFunction> activations;
+    size_t position = 0;
+
+    blob[position++] = static_cast<double>(layers);
+    for (size_t k = 0; k < layers; k++) blob[position++] = static_cast<double>(this->_layers->at(k)->_neuronsOut->size());
+
+    for (size_t k = 1; k < layers; k++) {
+        const auto& l = this->_layers->at(k);
+        // Flags: bias, 16 bit storage
+        uint8_t flags = (l->_bias_weights != nullptr ? 1 : 0);
+        if (l->_halfWeights != nullptr) flags |= (l->_halfWeights->Format() == WeightStorage::Half ? 2 : 4);
+        blob[position++] = static_cast<double>(flags);
+
+        if (l->_halfWeights == nullptr) {
+            for (size_t i = 0; i < l->_weights->Rows(); i++) {
+                memcpy(blob.get() + position, (*l->_weights.get())[i], l->_weights->Cols() * sizeof(double));
+                position += l->_weights->Cols();
+            }
+        }
+        else {
+            // The 16 bit weights are the ones Propagate()/Predict() run, also when a master copy is kept: kept in 16 bit, four in each double
+            const auto& H = *l->_halfWeights.get();
+            const size_t count = H.Rows() * H.Cols();
+            memcpy(blob.get() + position, H.Values(), count * sizeof(uint16_t));
+            position += (count + 3) / 4;
+        }
+        if (l->_bias_weights != nullptr) {
+            memcpy(blob.get() + position, l->_bias_weights->data(), l->_bias_weights->size() * sizeof(double));
+            position += l->_bias_weights->size();
+        }
+        activations.push_back(l->_f);
+    }
+
+    return make_unique<InferenceModel>(std::move(blob), size, activations);
+}
+
+unique_ptr<vector<double>> FCNN::ScoreNeurons(const size_t& layer, const NeuronScore& score, const vector<vector<double>>& samples /* = {} */) {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot score neurons: missing an output layer.");
+    if (layer < 1 || layer >= this->_layers->size() - 1) throw out_of_range("Cannot score neurons: not a hidden layer.");
+    if (score == NeuronScore::Activation && samples.size() == 0) throw runtime_error("Cannot score neurons by activation: samples needed.");
+    this->RequireMasterWeights("score neurons");
+
+    const auto& l = this->_layers->at(layer);
+    const auto& next = this->_layers->at(layer + 1);
+    const size_t neurons = l->_neuronsOut->size();
+
+    // Outgoing weights norm (column of next layer weights)
+    auto result = make_unique<vector<double>>(neurons, 0.0);
+    for (size_t i = 0; i < neurons; i++) {
+        double norm = 0.0;
+        for (size_t r = 0; r < next->_weights->Rows(); r++) norm += (*next->_weights)[r][i] * (*next->_weights)[r][i];
+        result->at(i) = sqrt(norm);
+    }
+
+    if (score == NeuronScore::WeightNorm) {
+        // Incoming weights norm (row of this layer weights)
+        for (size_t i = 0; i < neurons; i++) {
+            double norm = 0.0;
+            for (size_t c = 0; c < l->_weights->Cols(); c++) norm += (*l->_weights)[i][c] * (*l->_weights)[i][c];
+            result->at(i) *= sqrt(norm);
+        }
+    }
+    else {
+        // Mean absolute activation
+        vector<double> meanActivation(neurons, 0.0);
+        for (auto& sample : samples) {
+            this->SetInput(sample);
+            this->Propagate();
+            for (size_t i = 0; i < neurons; i++) meanActivation[i] += fabs(l->_neuronsOut->at(i)) / static_cast<double>(samples.size());
+        }
+        for (size_t i = 0; i < neurons; i++) result->at(i) *= meanActivation[i];
+    }
+
+    return std::move(result);
+}
+
+void FCNN::RemoveNeurons(const size_t& layer, const vector<size_t>& neurons) {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot remove neurons: missing an output layer.");
+    if (layer < 1 || layer >= this->_layers->size() - 1) throw out_of_range("Cannot remove neurons: not a hidden layer.");
+    this->RequireMasterWeights("remove neurons");
+
+    const auto& l = this->_layers->at(layer);
+    const auto& next = this->_layers->at(layer + 1);
+
+    // Neurons to keep
+    vector<bool> removed(l->_neuronsOut->size(), false);
+    for (auto& n : neurons) {
+        if (n >= removed.size()) throw out_of_range("Cannot remove neurons: neuron index out of range.");
+        removed[n] = true;
+    }
+    vector<size_t> keep;
+    for (size_t i = 0; i < removed.size(); i++) if (!removed[i]) keep.push_back(i);
+    if (keep.size() == 0) throw runtime_error("Cannot remove neurons: at least one neuron must remain.");
+
+    this->_incrementalValid = false;
+
+    vector<size_t> allRows, allCols;
+    for (size_t i = 0; i < next->_weights->Rows(); i++) allRows.push_back(i);
+    for (size_t i = 0; i < l->_weights->Cols(); i++) allCols.push_back(i);
+
+    // Rows of this layer and columns of next layer
+    l->_weights = l->_weights->Submatrix(keep, allCols);
+    next->_weights = next->_weights->Submatrix(allRows, keep);
+
+    // Bias and neuron values
+    auto select = [&keep](const unique_ptr<vector<double>>& v) {
+        auto r = make_unique<vector<double>>();
+        r->reserve(keep.size());
+        for (auto& i : keep) r->push_back(v->at(i));
+        return r;
+    };
+    if (l->_bias_weights != nullptr) l->_bias_weights = select(l->_bias_weights);
+    l->_neuronsNet = select(l->_neuronsNet);
+    l->_neuronsOut = select(l->_neuronsOut);
+    l->_delta.reset();
+
+    // Sparse weights (if pruned before) must follow the new shape
+    if (l->_sparseWeights != nullptr) l->_sparseWeights = make_unique<SparseMatrix>(*l->_weights.get());
+    if (next->_sparseWeights != nullptr) next->_sparseWeights = make_unique<SparseMatrix>(*next->_weights.get());
+    if (l->_halfWeights != nullptr) l->_halfWeights = make_unique<HalfMatrix>(*l->_weights.get(), l->_halfWeights->Format());
+    if (next->_halfWeights != nullptr) next->_halfWeights = make_unique<HalfMatrix>(*next->_weights.get(), next->_halfWeights->Format());
+}
+
+void FCNN::PruneNeurons(const double& fraction, const NeuronScore& score, const vector<vector<double>>& samples /* = {} */) {
+    // Check
+    if (fraction < 0.0 || fraction > 1.0) throw out_of_range("Cannot prune neurons: fraction must be between 0 and 1.");
+
+    for (size_t k = 1; k < this->_layers->size() - 1; k++) {
+        const size_t neurons = this->_layers->at(k)->_neuronsOut->size();
+        size_t toRemove = static_cast<size_t>(fraction * static_cast<double>(neurons));
+        if (toRemove >= neurons) toRemove = neurons - 1;
+        if (toRemove == 0) continue;
+
+        // Lowest scores first
+        auto scores = this->ScoreNeurons(k, score, samples);
+        vector<size_t> order;
+        for (size_t i = 0; i < neurons; i++) order.push_back(i);
+        std::stable_sort(order.begin(), order.end(), [&scores](const size_t& a, const size_t& b) { return scores->at(a) < scores->at(b); });
+        order.resize(toRemove);
+
+        this->RemoveNeurons(k, order);
+    }
+}
+
+double FCNN::PruneAndFinetune(const double& fraction, const uint8_t& steps, const NeuronScore& score, const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const size_t& epochs, const double& learningRate) {
+    // Check
+    if (steps == 0) throw out_of_range("Cannot prune neurons: steps must be > 0.");
+    if (inputs.size() != targets.size() || inputs.size() == 0) throw runtime_error("Cannot prune neurons: inputs and targets must have the same (not zero) size.");
+
+    // Each step removes the same fraction of the remaining neurons: (1 - stepFraction)^steps = 1 - fraction
+    const double stepFraction = 1.0 - pow(1.0 - fraction, 1.0 / static_cast<double>(steps));
+    double error = 0.0;
+
+    for (uint8_t s = 0; s < steps; s++) {
+        this->PruneNeurons(stepFraction, score, inputs);
+
+        for (size_t e = 0; e < epochs; e++) {
+            error = 0.0;
+            for (size_t i = 0; i < inputs.size(); i++) error += this->Train(inputs[i], targets[i], learningRate);
+            error /= static_cast<double>(inputs.size());
+        }
+    }
+
+    return error;
+}
+
+void FCNN::EnableQuantizationAware(const double& momentum /* = 0.99 */) {
+    // Check
+    if (momentum < 0.0 || momentum > 1.0) throw out_of_range("Quantization momentum must be between 0 and 1.");
+
+    this->_quantizationAware = true;
+    this->_quantizationMomentum = momentum;
+    this->_incrementalValid = false;
+    for (auto& l : *this->_layers.get()) {
+        l->_netObserver.Reset();
+        l->_outObserver.Reset();
+    }
+}
+
+void FCNN::DisableQuantizationAware() {
+    this->_quantizationAware = false;
+    this->_incrementalValid = false;
+    for (auto& l : *this->_layers.get()) {
+        l->_fakeWeights.reset();
+        l->_netObserver.Reset();
+        l->_outObserver.Reset();
+    }
+}
+
+void FCNN::PropagateQuantizationAware() {
+    BRIAND_TRACE_SCOPE("FCNN::PropagateQuantizationAware");
+    this->RequireMasterWeights("propagate quantization aware");
+
+    const bool observe = this->_quantizationObserve;
+    const double momentum = this->_quantizationMomentum;
+
+    // Fake quantize a layer's values with its observer (values pass unchanged until the first observation)
+    auto fake = [observe, momentum](QuantizationObserver& observer, vector<double>& values) {
+        if (observe) observer.Observe(values.data(), values.size(), momentum);
+        if (!observer.Initialized) return;
+        const auto q = observer.Parameters();
+        for (auto& v : values) v = q.FakeQuantize(v);
+    };
+
+    const auto& input = this->_layers->at(0);
+    fake(input->_outObserver, *input->_neuronsOut.get());
+
+    for (size_t k = 1; k < this->_layers->size(); k++) {
+        const auto& l = this->_layers->at(k);
+        const auto& l_prev = this->_layers->at(k-1);
+        const auto& W = *l->_weights.get();
+
+        BRIAND_TRACE_SCOPE_ARG("Propagate layer", static_cast<long>(k));
+
+        // Weights: symmetric per row, as exported (scale max|w| / 127, zero point 0)
+        if (l->_fakeWeights == nullptr || l->_fakeWeights->Rows() != W.Rows() || l->_fakeWeights->Cols() != W.Cols()) l->_fakeWeights = make_unique<Matrix>(W.Rows(), W.Cols());
+        auto& F = *l->_fakeWeights.get();
+        for (size_t i = 0; i < W.Rows(); i++) {
+            double range = 0.0;
+            for (size_t j = 0; j < W.Cols(); j++) range = std::max(range, fabs(W[i][j]));
+            const double scale = (range > 0.0 ? range / 127.0 : 1.0);
+            for (size_t j = 0; j < W.Cols(); j++) F[i][j] = round(W[i][j] / scale) * scale;
+        }
+
+        // Net values z = W_q * a_q + b, quantized as the integer model requantizes the accumulator
+        F.MultiplyVectorActivate(*l_prev->_neuronsOut.get(), l->_bias_weights.get(), Math::Identity, *l->_neuronsNet.get(), *l->_neuronsOut.get());
+        fake(l->_netObserver, *l->_neuronsNet.get());
+
+        // Activated values from the quantized net values (softmax output stays in double, as in the integer model)
+        const auto f = l->Elementwise();
+        auto& net = *l->_neuronsNet.get();
+        auto& out = *l->_neuronsOut.get();
+        for (size_t i = 0; i < net.size(); i++) out[i] = f(net[i]);
+        l->Normalize(out.data());
+        if (!l->_softmax) fake(l->_outObserver, out);
+    }
+}
+
+void FCNN::Calibrate(const vector<vector<double>>& samples) {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot calibrate: missing an output layer.");
+
+    if (!this->_quantizationAware) this->EnableQuantizationAware();
+
+    this->_quantizationObserve = true;
+    for (auto& x : samples) {
+        this->SetInput(x);
+        this->Propagate();
+    }
+    this->_quantizationObserve = false;
+}
+
+unique_ptr<QuantizedModel> FCNN::Quantize() {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot quantize: missing an output layer.");
+    this->RequireMasterWeights("quantize");
+    if (!this->_layers->at(0)->_outObserver.Initialized) throw runtime_error("Cannot quantize: no ranges observed, train with quantization aware mode or calibrate.");
+    if (this->_layers->at(0)->_bias_weights != nullptr) this->FoldInputBias();
+
+    vector<QuantizedLayer> layers;
+
+    for (size_t k = 1; k < this->_layers->size(); k++) {
+        const auto& l = this->_layers->at(k);
+        const auto& W = *l->_weights.get();
+
+        QuantizedLayer q;
+        q.Inputs = W.Cols();
+        q.Outputs = W.Rows();
+        q.Softmax = l->_softmax;
+        q.Input = this->_layers->at(k-1)->_outObserver.Parameters();
+        q.Net = l->_netObserver.Parameters();
+        if (!l->_softmax) q.Output = l->_outObserver.Parameters();
+
+        q.Weights.resize(q.Inputs * q.Outputs);
+        q.WeightScales.resize(q.Outputs);
+        q.Bias.resize(q.Outputs);
+        q.RowSums.resize(q.Outputs);
+        q.Multipliers.resize(q.Outputs);
+        q.Shifts.resize(q.Outputs);
+
+        for (size_t i = 0; i < q.Outputs; i++) {
+            double range = 0.0;
+            for (size_t j = 0; j < q.Inputs; j++) range = std::max(range, fabs(W[i][j]));
+            q.WeightScales[i] = (range > 0.0 ? range / 127.0 : 1.0);
+
+            int32_t sum = 0;
+            for (size_t j = 0; j < q.Inputs; j++) {
+                const int8_t w = static_cast<int8_t>(round(W[i][j] / q.WeightScales[i]));
+                q.Weights[i * q.Inputs + j] = w;
+                sum += w;
+            }
+            q.RowSums[i] = sum;
+
+            const double accumulatorScale = q.Input.Scale * q.WeightScales[i];
+            if (l->_bias_weights != nullptr) {
+                // Tiny weight scales can push the bias out of the accumulator range: saturate
+                const double bias = round(l->_bias_weights->at(i) / accumulatorScale);
+                constexpr double lo = static_cast<double>(numeric_limits<int32_t>::min());
+                constexpr double hi = static_cast<double>(numeric_limits<int32_t>::max());
+                q.Bias[i] = static_cast<int32_t>(bias < lo ? lo : (bias > hi ? hi : bias));
+            }
+            else q.Bias[i] = 0;
+            QuantizedLayer::QuantizeMultiplier(accumulatorScale / q.Net.Scale, q.Multipliers[i], q.Shifts[i]);
+        }
+
+        // Activation table over all the int8 net values
+        for (int32_t n = -128; n <= 127; n++) q.Activation[n + 128] = (l->_softmax ? 0 : q.Output.Quantize(l->_f(q.Net.Dequantize(n))));
+
+        layers.push_back(std::move(q));
+    }
+
+    return make_unique<QuantizedModel>(std::move(layers));
+}
+
+void FCNN::RequireMasterWeights(const char* operation) const {
+    for (auto it = this->_layers->begin() + 1; it != this->_layers->end(); it++) 
+        if (it->get()->_weights == nullptr) throw runtime_error(string("Cannot ") + operation + ": 16 bit weights without the master copy.");
+}
+
+void FCNN::SetWeightStorage(const WeightStorage& storage, const bool& keepMaster /* = true */) {
+    // Check
+    if (!this->_hasOutputs) throw runtime_error("Cannot set weights storage: missing an output layer.");
+    if (this->_layers->at(0)->_bias_weights != nullptr) this->FoldInputBias();
+
+    for (auto it = this->_layers->begin() + 1; it != this->_layers->end(); it++) {
+        const auto& l = it->get();
+
+        // Master copy is needed to convert again: if dropped, it is rebuilt from the 16 bit weights
+        if (l->_weights == nullptr) l->_weights = l->_halfWeights->ToMatrix();
+
+        if (storage == WeightStorage::Double) l->_halfWeights.reset();
+        else {
+            l->_halfWeights = make_unique<HalfMatrix>(*l->_weights.get(), storage);
+            if (!keepMaster) l->_weights.reset();
+        }
+    }
+
+    this->_incrementalValid = false;
+}
+
+vector<pair<size_t, size_t>> FCNN::LayerShapes() {
+    vector<pair<size_t, size_t>> shapes;
+    for (auto it = this->_layers->begin() + 1; it != this->_layers->end(); it++) {
+        const auto& l = it->get();
+        if (l->_weights != nullptr) shapes.push_back({ l->_weights->Rows(), l->_weights->Cols() });
+        else shapes.push_back({ l->_halfWeights->Rows(), l->_halfWeights->Cols() });
+    }
+    return shapes;
+}
+
+size_t FCNN::Parameters() {
+    size_t params = 0;
+
+    for (auto it = this->_layers->begin(); it != this->_layers->end(); it++) {
+        const auto& l = it->get();
+        if (l->_weights != nullptr) params += l->_weights->Rows() * l->_weights->Cols();
+        else if (l->_halfWeights != nullptr) params += l->_halfWeights->Rows() * l->_halfWeights->Cols();
+        if (l->_bias_weights != nullptr) params += l->_bias_weights->size();
+    }
+
+    return params;
+}
\ No newline at end of file
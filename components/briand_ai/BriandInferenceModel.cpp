@@ -0,0 +1,196 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandInferenceModel.hxx"
+
+using namespace std;
+using namespace Briand;
+
+ExecutionContext::ExecutionContext(const size_t& width) {
+    this->_width = 0;
+    this->Reserve(width);
+}
+
+size_t ExecutionContext::Width() const {
+    return this->_width;
+}
+
+void ExecutionContext::Reserve(const size_t& width) {
+    if (width <= this->_width) return;
+    this->_width = width;
+    for (auto& b : this->_buffers) b = make_unique<double[]>(width);
+}
+
+size_t ExecutionContext::MemoryUsage() const {
+    return sizeof(ExecutionContext) + 2 * this->_width * sizeof(double);
+}
+
+InferenceModel::InferenceModel(unique_ptr<double[]> blob, const size_t& size, const vector<ActivationFunction>& activations) {
+    this->_ownedBlob = std::move(blob);
+    this->_blob = this->_ownedBlob.get();
+    this->_blobSize = size;
+    this->Build(activations);
+}
+
+InferenceModel::InferenceModel(const double* blob, const size_t& size, const vector<ActivationFunction>& activations) {
+    this->_ownedBlob = nullptr;
+    this->_blob = blob;
+    this->_blobSize = size;
+    this->Build(activations);
+}
+
+InferenceModel::~InferenceModel() {
+    this->_layers.clear();
+    this->_ownedBlob.reset();
+}
+
+void InferenceModel::Build(const vector<ActivationFunction>& activations) {
+    // Check
+    if (this->_blob == nullptr || this->_blobSize < 3) throw runtime_error("InferenceModel: invalid blob.");
+
+    const size_t layers = static_cast<size_t>(this->_blob[0]);
+    if (layers < 2 || this->_blobSize < 1 + layers) throw runtime_error("InferenceModel: invalid blob, at least 2 layers required.");
+    if (activations.size() != layers - 1) throw out_of_range("InferenceModel: one activation function for each layer after the input is required.");
+
+    size_t position = 1 + layers;
+    this->_widest = 0;
+
+    for (size_t k = 0; k < layers; k++) {
+        const size_t neurons = static_cast<size_t>(this->_blob[1 + k]);
+        if (neurons == 0) throw runtime_error("InferenceModel: invalid blob, layer without neurons.");
+        if (neurons > this->_widest) this->_widest = neurons;
+        if (k == 0) continue;
+
+        if (activations[k-1] == nullptr) throw runtime_error("InferenceModel: missing activation function.");
+        if (position >= this->_blobSize) throw runtime_error("InferenceModel: invalid blob, too short.");
+
+        InferenceLayer l;
+        l.Inputs = static_cast<size_t>(this->_blob[1 + k - 1]);
+        l.Outputs = neurons;
+        l.F = activations[k-1];
+        l.Softmax = (l.F == Math::Softmax);
+
+        const double flags = this->_blob[position++];
+        if (flags < 0.0 || flags > 5.0 || flags != static_cast<double>(static_cast<uint8_t>(flags))) throw runtime_error("InferenceModel: invalid blob, unknown layer flags.");
+        const bool hasBias = ((static_cast<uint8_t>(flags) & 1) != 0);
+        const uint8_t storage = static_cast<uint8_t>(flags) >> 1;
+        l.Storage = (storage == 0 ? WeightStorage::Double : (storage == 1 ? WeightStorage::Half : WeightStorage::BFloat16));
+
+        // 16 bit weights: four in each double
+        const size_t weights = (storage == 0 ? l.Inputs * l.Outputs : (l.Inputs * l.Outputs + 3) / 4);
+        const size_t needed = weights + (hasBias ? l.Outputs : 0);
+        if (position + needed > this->_blobSize) throw runtime_error("InferenceModel: invalid blob, too short.");
+
+        l.Weights = (storage == 0 ? this->_blob + position : nullptr);
+        l.HalfWeights = (storage == 0 ? nullptr : reinterpret_cast<const uint16_t*>(this->_blob + position));
+        position += weights;
+        l.Bias = (hasBias ? this->_blob + position : nullptr);
+        if (hasBias) position += l.Outputs;
+
+        this->_layers.push_back(l);
+    }
+
+    if (position != this->_blobSize) throw runtime_error("InferenceModel: invalid blob, size mismatch.");
+
+    this->_context = this->CreateContext();
+}
+
+size_t InferenceModel::Inputs() const {
+    return this->_layers.front().Inputs;
+}
+
+size_t InferenceModel::Outputs() const {
+    return this->_layers.back().Outputs;
+}
+
+const vector<InferenceLayer>& InferenceModel::Layers() const {
+    return this->_layers;
+}
+
+size_t InferenceModel::WidestLayer() const {
+    return this->_widest;
+}
+
+const double* InferenceModel::Blob() const {
+    return this->_blob;
+}
+
+size_t InferenceModel::BlobSize() const {
+    return this->_blobSize;
+}
+
+unique_ptr<ExecutionContext> InferenceModel::CreateContext() const {
+    return make_unique<ExecutionContext>(this->_widest);
+}
+
+void InferenceModel::Predict(const double* inputs, double* outputs) {
+    this->Predict(inputs, outputs, *this->_context.get());
+}
+
+void InferenceModel::Predict(const double* inputs, double* outputs, ExecutionContext& context) const {
+    context.Reserve(this->_widest);
+    const double* x = inputs;
+
+    for (size_t k = 0; k < this->_layers.size(); k++) {
+        const auto& l = this->_layers[k];
+
+        // Latest layer writes directly to outputs, the others alternate the two buffers
+        double* y = (k == this->_layers.size() - 1 ? outputs : context.Buffer(k));
+
+        if (l.HalfWeights != nullptr) {
+            HalfMatrix::MultiplyVector(l.HalfWeights, l.Outputs, l.Inputs, l.Storage, x, y);
+            for (size_t i = 0; i < l.Outputs; i++) {
+                const double z = y[i] + (l.Bias != nullptr ? l.Bias[i] : 0.0);
+                y[i] = (l.Softmax ? z : l.F(z));
+            }
+        }
+        else {
+            const double* w = l.Weights;
+            for (size_t i = 0; i < l.Outputs; i++, w += l.Inputs) {
+                double z = 0.0;
+                for (size_t j = 0; j < l.Inputs; j++) z += w[j] * x[j];
+                if (l.Bias != nullptr) z += l.Bias[i];
+                y[i] = (l.Softmax ? z : l.F(z));
+            }
+        }
+        if (l.Softmax) Math::SoftmaxInPlace(y, l.Outputs);
+
+        x = y;
+    }
+}
+
+unique_ptr<vector<double>> InferenceModel::Predict(const vector<double>& inputs) {
+    return this->Predict(inputs, *this->_context.get());
+}
+
+unique_ptr<vector<double>> InferenceModel::Predict(const vector<double>& inputs, ExecutionContext& context) const {
+    // Check
+    if (inputs.size() != this->Inputs()) throw out_of_range("InferenceModel: invalid inputs size.");
+
+    auto result = make_unique<vector<double>>(this->Outputs());
+    this->Predict(inputs.data(), result->data(), context);
+
+    return std::move(result);
+}
+
+size_t InferenceModel::MemoryUsage() const {
+    size_t bytes = sizeof(InferenceModel);
+    bytes += this->_layers.capacity() * sizeof(InferenceLayer);
+    bytes += this->_context->MemoryUsage();
+    if (this->_ownedBlob != nullptr) bytes += this->_blobSize * sizeof(double);
+    return bytes;
+}
@@ -0,0 +1,213 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandKernelProfile.hxx"
+
+using namespace std;
+using namespace Briand;
+
+atomic<const KernelProfile::MatVecMap*> KernelProfile::_matVec(nullptr);
+unique_ptr<const KernelProfile::MatVecMap> KernelProfile::_current;
+vector<unique_ptr<const KernelProfile::MatVecMap>> KernelProfile::_retired;
+mutex KernelProfile::_lock;
+atomic<size_t> KernelProfile::_transposeTile(BRIAND_AI_TRANSPOSE_TILE);
+
+/// @brief Profile text header (change the version when the format changes)
+static const char* BRIAND_KERNEL_PROFILE_HEADER = "briand_ai kernel profile 1";
+
+bool KernelProfile::UseParallel(const size_t& rows, const size_t& cols) {
+    if (rows < 2 || TaskPool::Default().Workers() < 2) return false;
+
+    MatVecKernel kernel;
+    if (Find(rows, cols, kernel)) return (kernel == MatVecKernel::Parallel);
+
+    // Default: large enough to be worth the dispatch on multiple cores
+    return (rows * cols >= BRIAND_AI_PARALLEL_THRESHOLD);
+}
+
+bool KernelProfile::Find(const size_t& rows, const size_t& cols, MatVecKernel& kernel) {
+    // Hot path (every matrix-vector product): no locks, the snapshot is never modified
+    const MatVecMap* matVec = _matVec.load(std::memory_order_acquire);
+    if (matVec == nullptr) return false;
+
+    auto it = matVec->find(Key(rows, cols));
+    if (it == matVec->end()) return false;
+    kernel = it->second;
+    return true;
+}
+
+void KernelProfile::Publish(MatVecMap&& matVec) {
+    // A lookup may still be reading the current snapshot: retire it, Reclaim() frees it
+    if (_current != nullptr) _retired.push_back(std::move(_current));
+
+    if (!matVec.empty()) _current = make_unique<const MatVecMap>(std::move(matVec));
+    _matVec.store(_current.get(), std::memory_order_release);
+}
+
+void KernelProfile::Set(const size_t& rows, const size_t& cols, const MatVecKernel& kernel) {
+    lock_guard<mutex> lock(_lock);
+    const MatVecMap* current = _matVec.load(std::memory_order_acquire);
+    MatVecMap matVec = (current != nullptr ? *current : MatVecMap());
+    matVec[Key(rows, cols)] = kernel;
+    Publish(std::move(matVec));
+}
+
+void KernelProfile::Merge(const MatVecMap& kernels) {
+    if (kernels.empty()) return;
+
+    lock_guard<mutex> lock(_lock);
+    const MatVecMap* current = _matVec.load(std::memory_order_acquire);
+    MatVecMap matVec = (current != nullptr ? *current : MatVecMap());
+    for (auto& k : kernels) matVec[k.first] = k.second;
+    Publish(std::move(matVec));
+}
+
+void KernelProfile::Reclaim() {
+    lock_guard<mutex> lock(_lock);
+    _retired.clear();
+}
+
+size_t KernelProfile::TransposeTile() {
+    return _transposeTile.load(std::memory_order_relaxed);
+}
+
+void KernelProfile::SetTransposeTile(const size_t& tile) {
+    if (tile == 0 || tile % 2 != 0) throw out_of_range("KernelProfile: transpose tile must be even and > 0.");
+    _transposeTile = tile;
+}
+
+void KernelProfile::Clear() {
+    lock_guard<mutex> lock(_lock);
+    Publish(MatVecMap());
+    _transposeTile = BRIAND_AI_TRANSPOSE_TILE;
+}
+
+string KernelProfile::Signature() {
+    string arch;
+#if defined(ESP_PLATFORM)
+    arch = CONFIG_IDF_TARGET;
+#elif defined(__x86_64__)
+    arch = "x86_64";
+#elif defined(__aarch64__)
+    arch = "aarch64";
+#elif defined(__arm__)
+    arch = "arm";
+#else
+    arch = "unknown";
+#endif
+    return arch + "-" + to_string(TaskPool::Default().Workers()) + "w";
+}
+
+string KernelProfile::ToString() {
+    string text = string(BRIAND_KERNEL_PROFILE_HEADER) + "\n";
+    text += "signature " + Signature() + "\n";
+    text += "transpose_tile " + to_string(TransposeTile()) + "\n";
+
+    const MatVecMap* matVec = _matVec.load(std::memory_order_acquire);
+    if (matVec != nullptr) for (auto& e : *matVec) {
+        text += "matvec " + to_string(e.first >> 32) + " " + to_string(e.first & 0xFFFFFFFF) + " " + (e.second == MatVecKernel::Parallel ? "parallel" : "serial") + "\n";
+    }
+
+    return text;
+}
+
+bool KernelProfile::FromString(const string& text) {
+    MatVecMap matVec;
+    size_t tile = BRIAND_AI_TRANSPOSE_TILE;
+    bool header = false, signature = false;
+
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == string::npos) end = text.size();
+        const string line = text.substr(start, end - start);
+        start = end + 1;
+        if (line.empty()) continue;
+
+        if (!header) {
+            if (line != BRIAND_KERNEL_PROFILE_HEADER) return false;
+            header = true;
+            continue;
+        }
+
+        char word[32], kernel[16];
+        unsigned long a = 0, b = 0;
+        if (sscanf(line.c_str(), "signature %31s", word) == 1) {
+            if (Signature() != word) return false;
+            signature = true;
+        }
+        else if (sscanf(line.c_str(), "transpose_tile %lu", &a) == 1) {
+            if (a == 0 || a % 2 != 0) return false;
+            tile = a;
+        }
+        else if (sscanf(line.c_str(), "matvec %lu %lu %15s", &a, &b, kernel) == 3) {
+            matVec[Key(a, b)] = (strcmp(kernel, "parallel") == 0 ? MatVecKernel::Parallel : MatVecKernel::Serial);
+        }
+        else return false;
+    }
+
+    if (!header || !signature) return false;
+
+    lock_guard<mutex> lock(_lock);
+    Publish(std::move(matVec));
+    _transposeTile = tile;
+
+    return true;
+}
+
+bool KernelProfile::Save(const char* name) {
+    const string text = ToString();
+
+#if defined(ESP_PLATFORM)
+    nvs_handle_t handle;
+    if (nvs_open("briand_ai", NVS_READWRITE, &handle) != ESP_OK) return false;
+    bool saved = (nvs_set_blob(handle, name, text.data(), text.size()) == ESP_OK && nvs_commit(handle) == ESP_OK);
+    nvs_close(handle);
+    return saved;
+#else
+    FILE* f = fopen(name, "w");
+    if (f == NULL) return false;
+    bool saved = (fwrite(text.data(), 1, text.size(), f) == text.size());
+    fclose(f);
+    return saved;
+#endif
+}
+
+bool KernelProfile::Load(const char* name) {
+    string text;
+
+#if defined(ESP_PLATFORM)
+    nvs_handle_t handle;
+    if (nvs_open("briand_ai", NVS_READONLY, &handle) != ESP_OK) return false;
+    size_t size = 0;
+    if (nvs_get_blob(handle, name, NULL, &size) == ESP_OK && size > 0) {
+        text.resize(size);
+        if (nvs_get_blob(handle, name, &text[0], &size) != ESP_OK) text.clear();
+    }
+    nvs_close(handle);
+#else
+    FILE* f = fopen(name, "r");
+    if (f == NULL) return false;
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) text.append(buffer, n);
+    fclose(f);
+#endif
+
+    if (text.empty()) return false;
+    return FromString(text);
+}
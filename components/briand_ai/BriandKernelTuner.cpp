@@ -0,0 +1,118 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandKernelTuner.hxx"
+
+using namespace std;
+using namespace Briand;
+
+/// @brief Best time of runs calls of f
+static uint64_t briand_best_time(const uint8_t& runs, const function<void()>& f) {
+    uint64_t best = UINT64_MAX;
+    for (uint8_t i = 0; i < runs; i++) {
+        const uint64_t start = esp_timer_get_time();
+        f();
+        const uint64_t took = esp_timer_get_time() - start;
+        if (took < best) best = took;
+    }
+    return best;
+}
+
+void KernelTuner::TuneMatVec(const vector<pair<size_t, size_t>>& shapes, const uint8_t& runs /* = 20 */) {
+    // Results are collected here and published once (each publish copies the profile)
+    KernelProfile::MatVecMap tuned;
+
+    for (auto& shape : shapes) {
+        // Single core: nothing to choose
+        if (shape.first < 2 || TaskPool::Default().Workers() < 2) {
+            tuned[KernelProfile::Key(shape.first, shape.second)] = MatVecKernel::Serial;
+            continue;
+        }
+
+        Matrix m(shape.first, shape.second);
+        m.RandomizeUniform(-1.0, 1.0, 0);
+        vector<double> x(shape.second, 0.5), y(shape.first);
+        const double* xp = x.data();
+        double* yp = y.data();
+
+        // The two kernels Matrix dispatches to
+        const uint64_t serial = briand_best_time(runs, [&m, xp, yp] { m.MultiplyVectorRows(xp, yp, 0, m.Rows()); });
+        const uint64_t parallel = briand_best_time(runs, [&m, xp, yp] { 
+            TaskPool::Default().ParallelFor(0, m.Rows(), 0, [&m, xp, yp](size_t from, size_t to) { m.MultiplyVectorRows(xp, yp, from, to); }); 
+        });
+
+        tuned[KernelProfile::Key(shape.first, shape.second)] = (parallel < serial ? MatVecKernel::Parallel : MatVecKernel::Serial);
+
+        BRIAND_LOGD("BriandKernelTuner", "Mat-vec %lux%lu: serial %luus, parallel %luus.", static_cast<unsigned long>(shape.first), static_cast<unsigned long>(shape.second), static_cast<unsigned long>(serial), static_cast<unsigned long>(parallel));
+    }
+
+    KernelProfile::Merge(tuned);
+}
+
+void KernelTuner::TuneTranspose(const size_t& size, const uint8_t& runs /* = 5 */) {
+    Matrix a(size, size), t(size, size);
+    a.RandomizeUniform(0.0, 1.0, 0);
+
+    size_t bestTile = BRIAND_AI_TRANSPOSE_TILE;
+    uint64_t bestTime = UINT64_MAX;
+
+    for (size_t tile : { 8, 16, 32, 64, 128 }) {
+        if (tile > size) break;
+        KernelProfile::SetTransposeTile(tile);
+        const uint64_t took = briand_best_time(runs, [&a, &t] { a.Transpose(t); });
+        if (took < bestTime) {
+            bestTime = took;
+            bestTile = tile;
+        }
+
+        BRIAND_LOGD("BriandKernelTuner", "Transpose %lux%lu tile %lu: %luus.", static_cast<unsigned long>(size), static_cast<unsigned long>(size), static_cast<unsigned long>(tile), static_cast<unsigned long>(took));
+    }
+
+    KernelProfile::SetTransposeTile(bestTile);
+}
+
+bool KernelTuner::LoadOrTune(FCNN& fcnn, const char* name) {
+    const auto shapes = fcnn.LayerShapes();
+    const bool loaded = KernelProfile::Load(name);
+
+    // Shapes not in the profile
+    vector<pair<size_t, size_t>> missing;
+    MatVecKernel kernel;
+    for (auto& s : shapes) if (!KernelProfile::Find(s.first, s.second, kernel)) missing.push_back(s);
+
+    if (loaded && missing.empty()) {
+        BRIAND_LOGI("BriandKernelTuner", "Kernel profile %s loaded.", name);
+        KernelProfile::Reclaim();
+        return false;
+    }
+
+    BRIAND_LOGI("BriandKernelTuner", "Tuning %lu shapes%s.", static_cast<unsigned long>(missing.size()), loaded ? "" : " and transpose tile");
+
+    TuneMatVec(missing);
+#if defined(ESP_PLATFORM)
+    if (!loaded) TuneTranspose(128);
+#else
+    if (!loaded) TuneTranspose(512);
+#endif
+
+    if (!KernelProfile::Save(name)) BRIAND_LOGW("BriandKernelTuner", "Cannot save kernel profile %s.", name);
+
+    // Startup, the network is not running yet: the snapshots replaced by loading and tuning can go
+    KernelProfile::Reclaim();
+
+    return true;
+}
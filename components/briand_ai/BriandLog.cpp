@@ -0,0 +1,190 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandLog.hxx"
+#include <cstdarg>
+
+using namespace std;
+using namespace Briand;
+
+/** @brief Log internal state. Never destroyed: records may be written while the program ends. */
+class BriandLogState {
+    public:
+    mutex TagsLock;
+    map<string, unique_ptr<LogTag>> Tags;
+    int DefaultLevel = BRIAND_AI_LOG_LEVEL;
+
+    mutex QueueLock;
+    condition_variable QueueReady;
+    condition_variable QueueEmpty;
+    vector<LogRecord> Queue;
+    bool Writing = false;
+    bool SinkStarted = false;
+    atomic<size_t> Dropped { 0 };
+    FILE* Output = stdout;
+};
+
+static BriandLogState& BriandLogGetState() {
+    static BriandLogState* state = new BriandLogState();
+    return *state;
+}
+
+LogTag* Log::GetTag(const char* name) {
+    auto& state = BriandLogGetState();
+    lock_guard<mutex> lock(state.TagsLock);
+
+    auto it = state.Tags.find(string(name));
+    if (it != state.Tags.end()) return it->second.get();
+
+    auto tag = make_unique<LogTag>();
+    tag->Name = string(name);
+    tag->Level = state.DefaultLevel;
+    auto ptr = tag.get();
+    state.Tags[tag->Name] = std::move(tag);
+
+    return ptr;
+}
+
+void Log::SetLevel(const char* name, const int& level) {
+    if (strcmp(name, "*") == 0) {
+        auto& state = BriandLogGetState();
+        lock_guard<mutex> lock(state.TagsLock);
+        state.DefaultLevel = level;
+        for (auto& t : state.Tags) t.second->Level = level;
+    }
+    else {
+        GetTag(name)->Level = level;
+    }
+}
+
+void Log::Write(const int& level, const LogTag* tag, const char* format, ...) {
+    LogRecord record;
+    record.Level = level;
+    record.Tag = tag;
+    record.Time = esp_timer_get_time();
+    record.Rows = 0;
+    record.Cols = 0;
+
+    // Format here (arguments may not live until the sink writes)
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (n >= static_cast<int>(sizeof(buffer))) {
+        record.Text.resize(n + 1);
+        va_start(args, format);
+        vsnprintf(&record.Text[0], n + 1, format, args);
+        va_end(args);
+        record.Text.resize(n);
+    }
+    else if (n > 0) {
+        record.Text.assign(buffer, n);
+    }
+
+    Push(std::move(record));
+}
+
+void Log::WriteValues(const int& level, const LogTag* tag, const char* name, const vector<double>& values, const size_t& rows, const size_t& cols) {
+    LogRecord record;
+    record.Level = level;
+    record.Tag = tag;
+    record.Time = esp_timer_get_time();
+    record.Text = string(name);
+    record.Values = values;
+    record.Rows = rows;
+    record.Cols = cols;
+
+    Push(std::move(record));
+}
+
+void Log::Push(LogRecord&& record) {
+    auto& state = BriandLogGetState();
+
+    {
+        lock_guard<mutex> lock(state.QueueLock);
+        
+        if (state.Queue.size() >= BRIAND_AI_LOG_QUEUE) {
+            state.Dropped++;
+            return;
+        }
+
+        state.Queue.push_back(std::move(record));
+
+        if (!state.SinkStarted) {
+            state.SinkStarted = true;
+            std::thread(&Log::SinkLoop).detach();
+        }
+    }
+
+    state.QueueReady.notify_one();
+}
+
+void Log::SinkLoop() {
+    auto& state = BriandLogGetState();
+    vector<LogRecord> batch;
+    const char LEVELS[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+
+    while (true) {
+        {
+            // Take all the queued records at once
+            unique_lock<mutex> lock(state.QueueLock);
+            state.Writing = false;
+            state.QueueEmpty.notify_all();
+            state.QueueReady.wait(lock, [&state] { return !state.Queue.empty(); });
+            batch.swap(state.Queue);
+            state.Writing = true;
+        }
+
+        for (auto& r : batch) {
+            const char letter = (r.Level >= 0 && r.Level <= 5 ? LEVELS[r.Level] : '?');
+            fprintf(state.Output, "%c (%lu) %s: %s", letter, static_cast<unsigned long>(r.Time / 1000), r.Tag->Name.c_str(), r.Text.c_str());
+
+            if (r.Rows > 0) {
+                fprintf(state.Output, " (%lux%lu) =", static_cast<unsigned long>(r.Rows), static_cast<unsigned long>(r.Cols));
+                for (size_t i = 0; i < r.Rows; i++) {
+                    fprintf(state.Output, "%s|  ", (r.Rows > 1 ? "\n" : " "));
+                    for (size_t j = 0; j < r.Cols; j++) fprintf(state.Output, "%.2lf  ", r.Values[i * r.Cols + j]);
+                    fprintf(state.Output, "|");
+                }
+            }
+
+            fprintf(state.Output, "\n");
+        }
+
+        fflush(state.Output);
+        batch.clear();
+    }
+}
+
+void Log::SetOutput(FILE* out) {
+    auto& state = BriandLogGetState();
+    Flush();
+    lock_guard<mutex> lock(state.QueueLock);
+    state.Output = out;
+}
+
+void Log::Flush() {
+    auto& state = BriandLogGetState();
+    unique_lock<mutex> lock(state.QueueLock);
+    state.QueueEmpty.wait(lock, [&state] { return state.Queue.empty() && !state.Writing; });
+}
+
+size_t Log::Dropped() {
+    return BriandLogGetState().Dropped;
+}
@@ -30,5 +30,30 @@ double Briand::Math::WeightedSum(const vector<double>& values, const vector<doub
 }
 
 double Briand::Math::Random() {
-    return esp_random() / static_cast<double>(UINT32_MAX);
+    return Briand::Random::ThreadLocal().Uniform();
+}
+
+Briand::ActivationFunction Briand::Math::DerivativeFromOutput(Briand::ActivationFunction df) {
+    if (df == DeIdentity) return DeIdentityFromOutput;
+    if (df == DeReLU) return DeReLUFromOutput;
+    if (df == DeSigmoid) return DeSigmoidFromOutput;
+    if (df == DeTanh) return DeTanhFromOutput;
+    return nullptr;
+}
+
+void Briand::Math::SoftmaxInPlace(double* values, const size_t& n) {
+    if (n == 0) return;
+
+    // Max subtraction: exp() never overflows and the largest term is exactly 1
+    double max = values[0];
+    for (size_t i = 1; i < n; i++) if (values[i] > max) max = values[i];
+
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        values[i] = exp(values[i] - max);
+        sum += values[i];
+    }
+
+    const double scale = 1.0 / sum;
+    for (size_t i = 0; i < n; i++) values[i] *= scale;
 }
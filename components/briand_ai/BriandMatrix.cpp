@@ -82,10 +82,56 @@ const size_t& Matrix::Cols() const {
 }
 
 void Matrix::Randomize() {
-    for (size_t i = 0; i < this->_rows; i++) {
-        for (size_t j = 0; j < this->_cols; j++) {
-            // Random between 0 and 1
-            this->at(i, j) = static_cast<double>(esp_random()) / static_cast<double>(RAND_MAX);        }
+    auto& generator = Random::ThreadLocal();
+    for (size_t i = 0; i < this->_rows; i++) generator.FillUniform(this->_matrix[i], this->_cols);
+}
+
+void Matrix::RandomizeUniform(const double& low, const double& high, const uint64_t& seed) {
+    auto fill = [this, low, high, seed](size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            Random generator(seed, i);
+            generator.FillUniform(this->_matrix[i], this->_cols, low, high);
+        }
+    };
+
+    if (this->_rows > 1 && this->_rows * this->_cols >= BRIAND_AI_PARALLEL_THRESHOLD && TaskPool::Default().Workers() > 1)
+        TaskPool::Default().ParallelFor(0, this->_rows, 0, fill);
+    else
+        fill(0, this->_rows);
+}
+
+void Matrix::RandomizeNormal(const double& mean, const double& stddev, const uint64_t& seed) {
+    auto fill = [this, mean, stddev, seed](size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            Random generator(seed, i);
+            generator.FillNormal(this->_matrix[i], this->_cols, mean, stddev);
+        }
+    };
+
+    if (this->_rows > 1 && this->_rows * this->_cols >= BRIAND_AI_PARALLEL_THRESHOLD && TaskPool::Default().Workers() > 1)
+        TaskPool::Default().ParallelFor(0, this->_rows, 0, fill);
+    else
+        fill(0, this->_rows);
+}
+
+void Matrix::RandomizeWeights(const WeightInit& init, const ActivationFunction& activation, const size_t& fanIn, const size_t& fanOut, const uint64_t& seed) {
+    WeightInit method = init;
+    if (method == WeightInit::Auto) method = (activation == Math::ReLU ? WeightInit::He : WeightInit::Xavier);
+
+    switch (method) {
+        case WeightInit::Uniform:
+            this->RandomizeUniform(0.0, 1.0, seed);
+            break;
+        case WeightInit::He:
+            // Keeps the variance of ReLU outputs equal to the variance of the inputs
+            this->RandomizeNormal(0.0, sqrt(2.0 / static_cast<double>(fanIn)), seed);
+            break;
+        default: {
+            // Xavier/Glorot: keeps the variance of forward and backward signals for symmetric activations
+            const double limit = sqrt(6.0 / static_cast<double>(fanIn + fanOut));
+            this->RandomizeUniform(-limit, limit, seed);
+            break;
+        }
     }
 }
 
@@ -98,22 +144,44 @@ void Matrix::MultiplyScalar(const double& k) {
 }
 
 unique_ptr<Matrix> Matrix::MultiplyMatrix(const Matrix& other) {
+    // Large enough to be worth the dispatch on multiple cores?
+    if (this->_rows > 1 && this->_rows * this->_cols * other.Cols() >= BRIAND_AI_PARALLEL_THRESHOLD && TaskPool::Default().Workers() > 1)
+        return this->MultiplyMatrixParallel(other, TaskPool::Default());
+
     // Condition: A x B is possible if number of cols in A equals the number of rows in B
     if (other.Rows() != this->Cols()) throw out_of_range("Matrix A(m,n)*B(n,p) failed: n has different value!");
 
     // A(m,n) * B(n,p) = C(m,p)
     auto result = make_unique<Matrix>(this->_rows, other.Cols(), 0.0); 
 
+    this->MultiplyMatrixRows(other, *result.get(), 0, this->_rows);
+
+    return std::move(result);
+}
+
+unique_ptr<Matrix> Matrix::MultiplyMatrixParallel(const Matrix& other, TaskPool& pool) {
+    // Condition: A x B is possible if number of cols in A equals the number of rows in B
+    if (other.Rows() != this->Cols()) throw out_of_range("Matrix A(m,n)*B(n,p) failed: n has different value!");
+
+    // A(m,n) * B(n,p) = C(m,p)
+    auto result = make_unique<Matrix>(this->_rows, other.Cols(), 0.0); 
+    Matrix& r = *result.get();
+
+    // Each worker calculates a block of rows
+    pool.ParallelFor(0, this->_rows, 0, [this, &other, &r](size_t from, size_t to) { this->MultiplyMatrixRows(other, r, from, to); });
+
+    return std::move(result);
+}
+
+void Matrix::MultiplyMatrixRows(const Matrix& other, Matrix& result, const size_t& from, const size_t& to) const {
     const size_t N = other.Rows();
 
-    for (size_t i = 0; i < result->Rows(); i++) {
-        for (size_t j = 0; j < result->Cols(); j++) {
+    for (size_t i = from; i < to; i++) {
+        for (size_t j = 0; j < result.Cols(); j++) {
             for (size_t k = 0; k < N; k++)
-                (*result.get())[i][j] += (*this)[i][k] * other[k][j];
+                result[i][j] += (*this)[i][k] * other[k][j];
         }
     }
-
-    return std::move(result);
 }
 
 unique_ptr<Matrix> Matrix::MultiplyMatrixHadamard(const Matrix& other) {
@@ -136,20 +204,77 @@ unique_ptr<Matrix> Matrix::MultiplyMatrixHadamard(const Matrix& other) {
 }
 
 unique_ptr<vector<double>> Matrix::MultiplyVector(const vector<double>& v) {
+    // Large enough to be worth the dispatch on multiple cores?
+    if (KernelProfile::UseParallel(this->_rows, this->_cols))
+        return this->MultiplyVectorParallel(v, TaskPool::Default());
+
+    // Condition: A x v is possible if number of cols in A equals the number of components in v
+    if (v.size() != this->Cols()) throw out_of_range("Matrix A(m,n)*v(n) failed: n has different value!");
+
+    auto r = make_unique<vector<double>>(this->_rows, 0.0);
+
+    this->MultiplyVectorRows(v.data(), r->data(), 0, this->_rows);
+
+    return std::move(r);
+}
+
+void Matrix::MultiplyVectorActivate(const vector<double>& x, const vector<double>* bias, const ActivationFunction& f, vector<double>& net, vector<double>& out) const {
+    // Check
+    if (x.size() != this->_cols) throw out_of_range("Matrix A(m,n)*v(n) failed: n has different value!");
+    if (bias != nullptr && bias->size() != this->_rows) throw out_of_range("Matrix A(m,n)*v(n) + b(m) failed: m has different value!");
+
+    if (net.size() != this->_rows) net.resize(this->_rows);
+    if (out.size() != this->_rows) out.resize(this->_rows);
+
+    const double* xp = x.data();
+    const double* bp = (bias != nullptr ? bias->data() : nullptr);
+    double* np = net.data();
+    double* op = out.data();
+
+    if (KernelProfile::UseParallel(this->_rows, this->_cols))
+        TaskPool::Default().ParallelFor(0, this->_rows, 0, [this, xp, bp, f, np, op](size_t from, size_t to) { this->MultiplyVectorActivateRows(xp, bp, f, np, op, from, to); });
+    else
+        this->MultiplyVectorActivateRows(xp, bp, f, np, op, 0, this->_rows);
+}
+
+void Matrix::MultiplyVectorActivate(const double* x, const double* bias, const ActivationFunction& f, double* out) const {
+    this->MultiplyVectorActivateRows(x, bias, f, nullptr, out, 0, this->_rows);
+}
+
+void Matrix::MultiplyVectorActivateRows(const double* x, const double* bias, ActivationFunction f, double* net, double* out, const size_t& from, const size_t& to) const {
+    for (size_t i = from; i < to; i++) {
+        const double* row = this->_matrix[i];
+        double z = 0.0;
+        for (size_t j = 0; j < this->_cols; j++) z += row[j] * x[j];
+        // Bias added after the sum, same rounding of the unfused version
+        if (bias != nullptr) z += bias[i];
+        if (net != nullptr) net[i] = z;
+        out[i] = f(z);
+    }
+}
+
+unique_ptr<vector<double>> Matrix::MultiplyVectorParallel(const vector<double>& v, TaskPool& pool) {
     // Condition: A x v is possible if number of cols in A equals the number of components in v
     if (v.size() != this->Cols()) throw out_of_range("Matrix A(m,n)*v(n) failed: n has different value!");
 
-    auto r = make_unique<vector<double>>();
+    auto r = make_unique<vector<double>>(this->_rows, 0.0);
+    const double* x = v.data();
+    double* y = r->data();
 
-    for (size_t i = 0; i < this->Rows(); i++) {
+    // Each worker calculates a block of rows
+    pool.ParallelFor(0, this->_rows, 0, [this, x, y](size_t from, size_t to) { this->MultiplyVectorRows(x, y, from, to); });
+
+    return std::move(r);
+}
+
+void Matrix::MultiplyVectorRows(const double* v, double* result, const size_t& from, const size_t& to) const {
+    for (size_t i = from; i < to; i++) {
         double ri = 0;
-        for (size_t j = 0; j < this->Cols(); j++) {
+        for (size_t j = 0; j < this->_cols; j++) {
             ri += this->_matrix[i][j] * v[j];
         }
-        r->push_back(ri);
+        result[i] = ri;
     }
-
-    return std::move(r);
 }
 
 unique_ptr<Matrix> Matrix::DotMultiplyVectors(const vector<double>& v1, const vector<double>& v2t) {
@@ -187,14 +312,75 @@ unique_ptr<Matrix> Matrix::ApplyFunction(double (*f)(const double& x)) {
 
 unique_ptr<Matrix> Matrix::Transpose() {
     auto result = make_unique<Matrix>(this->_cols, this->_rows, 0.0); 
+    this->Transpose(*result.get());
+    return std::move(result);
+}
 
-    for (size_t i = 0; i < this->_rows; i++) {
-        for (size_t j = 0; j < this->_cols; j++) {
-            (*result.get())[j][i] = this->_matrix[i][j];
+void Matrix::Transpose(Matrix& result) const {
+    // Check
+    if (result.Rows() != this->_cols || result.Cols() != this->_rows) throw out_of_range("Matrix transpose: result must be a n*m matrix.");
+
+    const size_t T = KernelProfile::TransposeTile();
+    for (size_t i = 0; i < this->_rows; i += T) {
+        for (size_t j = 0; j < this->_cols; j += T) {
+            this->TransposeTile(result, i, std::min(i + T, this->_rows), j, std::min(j + T, this->_cols));
         }
     }
+}
 
-    return std::move(result);
+void Matrix::TransposeTile(Matrix& result, const size_t& rowFrom, const size_t& rowTo, const size_t& colFrom, const size_t& colTo) const {
+    double** dst = result._matrix;
+    size_t i = rowFrom;
+
+    // 2x2 blocks: two source rows give two destination rows
+    for (; i + 1 < rowTo; i += 2) {
+        const double* a = this->_matrix[i];
+        const double* b = this->_matrix[i+1];
+        size_t j = colFrom;
+        for (; j + 1 < colTo; j += 2) {
+        #if defined(__SSE2__)
+            const __m128d ra = _mm_loadu_pd(a + j);
+            const __m128d rb = _mm_loadu_pd(b + j);
+            _mm_storeu_pd(dst[j] + i, _mm_unpacklo_pd(ra, rb));
+            _mm_storeu_pd(dst[j+1] + i, _mm_unpackhi_pd(ra, rb));
+        #else
+            const double a0 = a[j], a1 = a[j+1], b0 = b[j], b1 = b[j+1];
+            dst[j][i] = a0; dst[j][i+1] = b0;
+            dst[j+1][i] = a1; dst[j+1][i+1] = b1;
+        #endif
+        }
+        // Odd column
+        if (j < colTo) { dst[j][i] = a[j]; dst[j][i+1] = b[j]; }
+    }
+
+    // Odd row
+    if (i < rowTo) {
+        for (size_t j = colFrom; j < colTo; j++) dst[j][i] = this->_matrix[i][j];
+    }
+}
+
+void Matrix::TransposeInPlace() {
+    // Check
+    if (this->_rows != this->_cols) throw out_of_range("Matrix transpose in place: matrix must be square.");
+
+    const size_t T = KernelProfile::TransposeTile();
+    const size_t n = this->_rows;
+    double** m = this->_matrix;
+
+    for (size_t bi = 0; bi < n; bi += T) {
+        const size_t iTo = std::min(bi + T, n);
+
+        // Diagonal tile: swap above the diagonal
+        for (size_t i = bi; i < iTo; i++)
+            for (size_t j = i + 1; j < iTo; j++) std::swap(m[i][j], m[j][i]);
+
+        // Tile pairs (bi,bj) and (bj,bi)
+        for (size_t bj = bi + T; bj < n; bj += T) {
+            const size_t jTo = std::min(bj + T, n);
+            for (size_t i = bi; i < iTo; i++)
+                for (size_t j = bj; j < jTo; j++) std::swap(m[i][j], m[j][i]);
+        }
+    }
 }
 
 double*& Matrix::operator[](const size_t& idx) const {
@@ -224,3 +410,360 @@ void Matrix::PrintVector(const vector<double>& v) {
 }
 
 
+
+
+unique_ptr<Matrix> Matrix::Submatrix(const vector<size_t>& rows, const vector<size_t>& cols) const {
+    auto result = make_unique<Matrix>(rows.size(), cols.size(), 0.0);
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i] >= this->_rows) throw out_of_range("Submatrix failed: row index out of range!");
+        for (size_t j = 0; j < cols.size(); j++) {
+            if (cols[j] >= this->_cols) throw out_of_range("Submatrix failed: column index out of range!");
+            (*result.get())[i][j] = this->_matrix[rows[i]][cols[j]];
+        }
+    }
+
+    return std::move(result);
+}
+
+void Matrix::LogValues(const int& level, const LogTag* tag, const char* name) const {
+    vector<double> values;
+    values.reserve(this->_rows * this->_cols);
+    for (size_t i = 0; i < this->_rows; i++) values.insert(values.end(), this->_matrix[i], this->_matrix[i] + this->_cols);
+
+    Log::WriteValues(level, tag, name, values, this->_rows, this->_cols);
+}
+
+double Matrix::Prune(const double& sparsity) {
+    if (sparsity < 0.0 || sparsity > 1.0) throw out_of_range("Matrix prune failed: sparsity must be between 0 and 1.");
+
+    const size_t n = this->_rows * this->_cols;
+    const size_t toPrune = static_cast<size_t>(sparsity * static_cast<double>(n));
+    if (toPrune == 0) return 0.0;
+
+    // Find the magnitude threshold with a partial sort of absolute values
+    vector<double> magnitudes;
+    magnitudes.reserve(n);
+    for (size_t i = 0; i < this->_rows; i++)
+        for (size_t j = 0; j < this->_cols; j++)
+            magnitudes.push_back(fabs(this->_matrix[i][j]));
+
+    std::nth_element(magnitudes.begin(), magnitudes.begin() + (toPrune - 1), magnitudes.end());
+    const double threshold = magnitudes[toPrune - 1];
+
+    // Zero elements up to toPrune (ties at threshold may be kept if more than needed)
+    size_t pruned = 0;
+    for (size_t i = 0; i < this->_rows; i++) {
+        for (size_t j = 0; j < this->_cols; j++) {
+            if (fabs(this->_matrix[i][j]) < threshold) {
+                this->_matrix[i][j] = 0.0;
+                pruned++;
+            }
+        }
+    }
+    for (size_t i = 0; i < this->_rows && pruned < toPrune; i++) {
+        for (size_t j = 0; j < this->_cols && pruned < toPrune; j++) {
+            if (this->_matrix[i][j] != 0.0 && fabs(this->_matrix[i][j]) == threshold) {
+                this->_matrix[i][j] = 0.0;
+                pruned++;
+            }
+        }
+    }
+
+    return threshold;
+}
+
+double Matrix::Sparsity() const {
+    size_t zeros = 0;
+    for (size_t i = 0; i < this->_rows; i++)
+        for (size_t j = 0; j < this->_cols; j++)
+            if (this->_matrix[i][j] == 0.0) zeros++;
+
+    return static_cast<double>(zeros) / static_cast<double>(this->_rows * this->_cols);
+}
+
+size_t Matrix::MemoryUsage() const {
+    return this->_rows * this->_cols * sizeof(double) + this->_rows * sizeof(double*);
+}
+
+/**********************************************************************
+    TransposedView class
+***********************************************************************/
+
+TransposedView::TransposedView(const Matrix& m) : _m(m) {
+}
+
+const size_t& TransposedView::Rows() const {
+    return this->_m.Cols();
+}
+
+const size_t& TransposedView::Cols() const {
+    return this->_m.Rows();
+}
+
+unique_ptr<vector<double>> TransposedView::MultiplyVector(const vector<double>& v) const {
+    // Condition: M_T(n,m) x v(m)
+    if (v.size() != this->_m.Rows()) throw out_of_range("TransposedView A_T(n,m)*v(m) failed: m has different value!");
+
+    auto r = make_unique<vector<double>>(this->_m.Cols(), 0.0);
+    this->MultiplyVector(v.data(), r->data());
+
+    return std::move(r);
+}
+
+void TransposedView::MultiplyVector(const double* v, double* result) const {
+    const size_t cols = this->_m.Cols();
+    for (size_t j = 0; j < cols; j++) result[j] = 0.0;
+
+    // result += v_i * row_i, rows are read sequentially
+    for (size_t i = 0; i < this->_m.Rows(); i++) {
+        const double* row = this->_m[i];
+        const double vi = v[i];
+        for (size_t j = 0; j < cols; j++) result[j] += row[j] * vi;
+    }
+}
+
+unique_ptr<Matrix> TransposedView::ToMatrix() const {
+    auto result = make_unique<Matrix>(this->_m.Cols(), this->_m.Rows(), 0.0);
+    this->_m.Transpose(*result.get());
+    return std::move(result);
+}
+
+/**********************************************************************
+    SparseMatrix class
+***********************************************************************/
+
+SparseMatrix::SparseMatrix(const Matrix& dense) {
+    this->_rows = dense.Rows();
+    this->_cols = dense.Cols();
+
+    this->_rowStart.reserve(this->_rows + 1);
+    this->_rowStart.push_back(0);
+
+    for (size_t i = 0; i < this->_rows; i++) {
+        for (size_t j = 0; j < this->_cols; j++) {
+            if (dense[i][j] != 0.0) {
+                this->_values.push_back(dense[i][j]);
+                this->_colIndex.push_back(static_cast<uint32_t>(j));
+            }
+        }
+        this->_rowStart.push_back(static_cast<uint32_t>(this->_values.size()));
+    }
+
+    this->_values.shrink_to_fit();
+    this->_colIndex.shrink_to_fit();
+}
+
+const size_t& SparseMatrix::Rows() const {
+    return this->_rows;
+}
+
+const size_t& SparseMatrix::Cols() const {
+    return this->_cols;
+}
+
+size_t SparseMatrix::NonZeros() const {
+    return this->_values.size();
+}
+
+double SparseMatrix::Sparsity() const {
+    return 1.0 - static_cast<double>(this->_values.size()) / static_cast<double>(this->_rows * this->_cols);
+}
+
+size_t SparseMatrix::MemoryUsage() const {
+    return this->_values.size() * sizeof(double) + this->_colIndex.size() * sizeof(uint32_t) + this->_rowStart.size() * sizeof(uint32_t);
+}
+
+unique_ptr<vector<double>> SparseMatrix::MultiplyVector(const vector<double>& v) const {
+    // Condition: A x v is possible if number of cols in A equals the number of components in v
+    if (v.size() != this->_cols) throw out_of_range("SparseMatrix A(m,n)*v(n) failed: n has different value!");
+
+    auto r = make_unique<vector<double>>(this->_rows, 0.0);
+    this->MultiplyVector(v.data(), r->data());
+
+    return std::move(r);
+}
+
+void SparseMatrix::MultiplyVector(const double* x, double* y) const {
+    const double* values = this->_values.data();
+    const uint32_t* cols = this->_colIndex.data();
+
+    for (size_t i = 0; i < this->_rows; i++) {
+        double ri = 0;
+        for (uint32_t k = this->_rowStart[i]; k < this->_rowStart[i+1]; k++) {
+            ri += values[k] * x[cols[k]];
+        }
+        y[i] = ri;
+    }
+}
+
+void SparseMatrix::Reload(Matrix& dense) {
+    if (dense.Rows() != this->_rows || dense.Cols() != this->_cols) throw out_of_range("SparseMatrix reload failed: dense matrix has different size!");
+
+    for (size_t i = 0; i < this->_rows; i++) {
+        size_t j = 0;
+        for (uint32_t k = this->_rowStart[i]; k < this->_rowStart[i+1]; k++) {
+            // Zero the pruned elements before this one
+            for (; j < this->_colIndex[k]; j++) dense[i][j] = 0.0;
+            this->_values[k] = dense[i][j++];
+        }
+        for (; j < this->_cols; j++) dense[i][j] = 0.0;
+    }
+}
+
+unique_ptr<Matrix> SparseMatrix::ToDense() const {
+    auto result = make_unique<Matrix>(this->_rows, this->_cols, 0.0);
+
+    for (size_t i = 0; i < this->_rows; i++) {
+        for (uint32_t k = this->_rowStart[i]; k < this->_rowStart[i+1]; k++) {
+            (*result.get())[i][this->_colIndex[k]] = this->_values[k];
+        }
+    }
+
+    return std::move(result);
+}
+
+/**********************************************************************
+    HalfMatrix
+***********************************************************************/
+
+HalfMatrix::HalfMatrix(const Matrix& m, const WeightStorage& format) {
+    // Check
+    if (format == WeightStorage::Double) throw runtime_error("HalfMatrix: format must be Half or BFloat16.");
+
+    this->_rows = m.Rows();
+    this->_cols = m.Cols();
+    this->_format = format;
+    this->_values = make_unique<uint16_t[]>(this->_rows * this->_cols);
+    this->Reload(m);
+}
+
+const size_t& HalfMatrix::Rows() const {
+    return this->_rows;
+}
+
+const size_t& HalfMatrix::Cols() const {
+    return this->_cols;
+}
+
+const WeightStorage& HalfMatrix::Format() const {
+    return this->_format;
+}
+
+double HalfMatrix::at(const size_t& i, const size_t& j) const {
+    if (i >= this->_rows || j >= this->_cols) throw out_of_range("HalfMatrix: index out of range.");
+    const uint16_t v = this->_values[i * this->_cols + j];
+    return (this->_format == WeightStorage::Half ? HalfToFloat(v) : BFloat16ToFloat(v));
+}
+
+size_t HalfMatrix::MemoryUsage() const {
+    return this->_rows * this->_cols * sizeof(uint16_t);
+}
+
+const uint16_t* HalfMatrix::Values() const {
+    return this->_values.get();
+}
+
+void HalfMatrix::MultiplyVector(const double* x, double* y) const {
+    MultiplyVector(this->_values.get(), this->_rows, this->_cols, this->_format, x, y);
+}
+
+void HalfMatrix::MultiplyVector(const uint16_t* values, const size_t& rows, const size_t& cols, const WeightStorage& format, const double* x, double* y) {
+    // Each row is decoded in bulk into a reused float buffer (per thread: the matrix may be shared by many inference tasks),
+    // then the dot product runs on plain floats without any conversion in the inner loop.
+    thread_local vector<float> buffer;
+    if (buffer.size() < cols) buffer.resize(cols);
+    float* row = buffer.data();
+    const uint16_t* w = values;
+
+    for (size_t i = 0; i < rows; i++, w += cols) {
+        DecodeFloat(w, row, cols, format);
+
+        // Four partial sums: the additions do not wait for each other
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        size_t j = 0;
+        for (; j + 4 <= cols; j += 4) {
+            s0 += static_cast<double>(row[j]) * x[j];
+            s1 += static_cast<double>(row[j + 1]) * x[j + 1];
+            s2 += static_cast<double>(row[j + 2]) * x[j + 2];
+            s3 += static_cast<double>(row[j + 3]) * x[j + 3];
+        }
+        for (; j < cols; j++) s0 += static_cast<double>(row[j]) * x[j];
+
+        y[i] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+void HalfMatrix::Reload(const Matrix& m) {
+    // Check
+    if (m.Rows() != this->_rows || m.Cols() != this->_cols) throw runtime_error("HalfMatrix::Reload - matrix size mismatch.");
+
+    for (size_t i = 0; i < this->_rows; i++) Encode(m[i], this->_values.get() + i * this->_cols, this->_cols, this->_format);
+}
+
+unique_ptr<Matrix> HalfMatrix::ToMatrix() const {
+    auto m = make_unique<Matrix>(this->_rows, this->_cols);
+    for (size_t i = 0; i < this->_rows; i++) Decode(this->_values.get() + i * this->_cols, (*m.get())[i], this->_cols, this->_format);
+    return std::move(m);
+}
+
+void HalfMatrix::Encode(const double* src, uint16_t* dst, const size_t& n, const WeightStorage& format) {
+    if (format == WeightStorage::BFloat16) for (size_t i = 0; i < n; i++) dst[i] = FloatToBFloat16(static_cast<float>(src[i]));
+    else for (size_t i = 0; i < n; i++) dst[i] = FloatToHalf(static_cast<float>(src[i]));
+}
+
+void HalfMatrix::Decode(const uint16_t* src, double* dst, const size_t& n, const WeightStorage& format) {
+    if (format == WeightStorage::BFloat16) for (size_t i = 0; i < n; i++) dst[i] = BFloat16ToFloat(src[i]);
+    else for (size_t i = 0; i < n; i++) dst[i] = HalfToFloat(src[i]);
+}
+
+void HalfMatrix::DecodeFloat(const uint16_t* src, float* dst, const size_t& n, const WeightStorage& format) {
+    if (format == WeightStorage::BFloat16) {
+        // The high half of the float bits, in blocks of fixed size that the compiler vectorizes
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            uint32_t f[8];
+            for (size_t k = 0; k < 8; k++) f[k] = static_cast<uint32_t>(src[i + k]) << 16;
+            memcpy(dst + i, f, sizeof(f));
+        }
+        for (; i < n; i++) dst[i] = BFloat16ToFloat(src[i]);
+        return;
+    }
+
+    #if defined(ESP_PLATFORM)
+
+    // Float bits of sign and exponent (top 6 bits of a half), the mantissa is just shifted.
+    // Exponent 0 (zero and subnormals) needs a renormalization: converted one by one.
+    static const unique_ptr<uint32_t[]> high = [] {
+        auto t = make_unique<uint32_t[]>(64);
+        for (uint32_t e = 0; e < 64; e++) {
+            const uint32_t exponent = e & 0x1F;
+            t[e] = ((e & 0x20) << 26) | (exponent == 0x1F ? 0x7F800000u : (exponent + 127u - 15u) << 23);
+        }
+        return t;
+    }();
+
+    const uint32_t* bits = high.get();
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t h = src[i];
+        if ((h & 0x7C00) == 0) dst[i] = HalfToFloat(src[i]);
+        else {
+            const uint32_t f = bits[h >> 10] | ((h & 0x3FF) << 13);
+            memcpy(&dst[i], &f, sizeof(f));
+        }
+    }
+
+    #else
+
+    // Table of all the 65536 halves (256KB, built on first use)
+    static const unique_ptr<float[]> table = [] {
+        auto t = make_unique<float[]>(65536);
+        for (uint32_t h = 0; h < 65536; h++) t[h] = HalfToFloat(static_cast<uint16_t>(h));
+        return t;
+    }();
+
+    const float* lut = table.get();
+    for (size_t i = 0; i < n; i++) dst[i] = lut[src[i]];
+
+    #endif
+}
@@ -0,0 +1,186 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandPipeline.hxx"
+
+using namespace std;
+using namespace Briand;
+
+InferencePipeline::InferencePipeline(const FCNN& fcnn, const size_t& capacity /* = 8 */, const DropPolicy& policy /* = DropPolicy::DropNewest */)
+    : _fcnn(fcnn), _ring(capacity), _running(false), _stop(false), _sleeping(false), _produced(0), _published(0), _dropped(0), _depthSum(0), _maxDepth(0), _processed(0), _latencySum(0), _minLatency(UINT64_MAX), _maxLatency(0)
+{
+    this->_context = fcnn.CreateContext();
+    this->_policy = policy;
+    this->_callback = nullptr;
+    this->_sequence = 0;
+}
+
+InferencePipeline::~InferencePipeline() {
+    this->Stop();
+}
+
+void InferencePipeline::SetCallback(const function<void(const PipelineFrame&, const vector<double>&)>& callback) {
+    // Check
+    if (this->_running) throw runtime_error("InferencePipeline: cannot set the callback while running.");
+    this->_callback = callback;
+}
+
+void InferencePipeline::Start(const BaseType_t& core /* = tskNO_AFFINITY */, const uint32_t& stackSize /* = 4096 */, const UBaseType_t& priority /* = 5 */) {
+    // Check
+    if (this->_running) throw runtime_error("InferencePipeline: already running.");
+
+    this->_stop = false;
+    this->_running = true;
+    xTaskCreatePinnedToCore(InferenceTask, "briand_pipeline", stackSize, this, priority, NULL, core);
+}
+
+void InferencePipeline::Stop() {
+    if (!this->_running) return;
+    {
+        lock_guard<mutex> lock(this->_sleepLock);
+        this->_stop = true;
+    }
+    this->_wake.notify_one();
+    while (this->_running) vTaskDelay(1);
+}
+
+void InferencePipeline::InferenceTask(void* pipeline) {
+    static_cast<InferencePipeline*>(pipeline)->Run();
+
+    // A task must not return. On Linux porting the thread is cancelled by the scheduler loop.
+    vTaskDelete(NULL);
+    for (;;) vTaskDelay(1000);
+}
+
+void InferencePipeline::Run() {
+    if (Trace::IsEnabled()) Trace::SetThreadName("briand_pipeline");
+
+    // Outputs written in place for every frame: no allocations in the loop
+    vector<double> outputs(this->_fcnn.Outputs());
+    size_t idle = 0;
+
+    // DropOldest: the producer may evict the oldest slot, frames are copied out of the ring (vectors keep their capacity)
+    const bool shared = (this->_policy == DropPolicy::DropOldest);
+    PipelineFrame copy;
+
+    while (true) {
+        PipelineFrame* frame = (shared ? (this->_ring.TryPopShared(copy) ? &copy : nullptr) : this->_ring.Peek());
+
+        if (frame == nullptr) {
+            // Nothing queued: done if stopping, otherwise spin a little then sleep until the producer publishes
+            if (this->_stop) break;
+            if (++idle < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            unique_lock<mutex> lock(this->_sleepLock);
+            this->_sleeping = true;
+            // Pairs with the fence in Publish(): either the producer sees _sleeping or this sees the new frame
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            this->_wake.wait(lock, [this] { return this->_stop || this->_ring.Size() > 0; });
+            this->_sleeping = false;
+            continue;
+        }
+        idle = 0;
+
+        {
+            BRIAND_TRACE_SCOPE_ARG("Pipeline inference", static_cast<long>(frame->Sequence));
+            this->_fcnn.Predict(frame->Values.data(), frame->Values.size(), outputs.data(), *this->_context.get());
+        }
+
+        const uint64_t latency = esp_timer_get_time() - frame->Timestamp;
+        if (this->_callback != nullptr) this->_callback(*frame, outputs);
+
+        // Slot back to the producer only now: the frame was read in place (a copied frame was released by TryPopShared())
+        if (!shared) this->_ring.Release();
+
+        this->_processed++;
+        this->_latencySum += latency;
+        if (latency < this->_minLatency) this->_minLatency = latency;
+        if (latency > this->_maxLatency) this->_maxLatency = latency;
+    }
+
+    this->_running = false;
+}
+
+PipelineFrame* InferencePipeline::Acquire() {
+    PipelineFrame* frame = this->_ring.Acquire();
+    if (frame == nullptr && this->_policy == DropPolicy::Block) {
+        while ((frame = this->_ring.Acquire()) == nullptr) std::this_thread::yield();
+    }
+    else if (frame == nullptr && this->_policy == DropPolicy::DropOldest) {
+        // Make room discarding the oldest queued frame. Eviction fails only while the inference task copies that frame out.
+        while ((frame = this->_ring.Acquire()) == nullptr) {
+            if (this->_ring.Evict()) this->_dropped++;
+            else std::this_thread::yield();
+        }
+    }
+    else if (frame == nullptr) {
+        this->_produced++;
+        this->_dropped++;
+        this->_sequence++;
+    }
+    return frame;
+}
+
+void InferencePipeline::Publish() {
+    PipelineFrame* frame = this->_ring.Acquire();
+    frame->Sequence = this->_sequence++;
+    frame->Timestamp = esp_timer_get_time();
+    this->_ring.Publish();
+
+    // Wake the inference task only if it went to sleep, the lock is never taken while it is busy
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->_sleeping) {
+        lock_guard<mutex> lock(this->_sleepLock);
+        this->_wake.notify_one();
+    }
+
+    const size_t depth = this->_ring.Size();
+    this->_produced++;
+    this->_published++;
+    this->_depthSum += depth;
+    if (depth > this->_maxDepth) this->_maxDepth = depth;
+}
+
+bool InferencePipeline::Push(const vector<double>& values) {
+    PipelineFrame* frame = this->Acquire();
+    if (frame == nullptr) return false;
+
+    // Slot vectors keep their capacity: no allocation after the first round
+    frame->Values.assign(values.begin(), values.end());
+    this->Publish();
+    return true;
+}
+
+size_t InferencePipeline::Depth() const {
+    return this->_ring.Size();
+}
+
+PipelineStatistics InferencePipeline::Statistics() const {
+    PipelineStatistics s;
+    s.Produced = this->_produced;
+    s.Processed = this->_processed;
+    s.Dropped = this->_dropped;
+    s.MaxDepth = this->_maxDepth;
+    s.MeanDepth = (this->_published > 0 ? static_cast<double>(this->_depthSum) / static_cast<double>(this->_published) : 0.0);
+    s.MinLatency = (s.Processed > 0 ? this->_minLatency.load() : 0);
+    s.MeanLatency = (s.Processed > 0 ? static_cast<double>(this->_latencySum) / static_cast<double>(s.Processed) : 0.0);
+    s.MaxLatency = this->_maxLatency;
+    return s;
+}
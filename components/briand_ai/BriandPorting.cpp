@@ -24,10 +24,15 @@
 	}
 
 	unique_ptr<map<string, esp_log_level_t>> LOG_LEVELS_MAP;
+	mutex LOG_LEVELS_LOCK;
+	esp_log_level_t LOG_DEFAULT_LEVEL = ESP_LOG_NONE;
 	
 	void esp_log_level_set(const char* tag, esp_log_level_t level) {
-		// If wildcard, all to level.
+		lock_guard<mutex> lock(LOG_LEVELS_LOCK);
+
+		// If wildcard, all to level (new tags too).
 		if (strcmp(tag, "*") == 0) {
+			LOG_DEFAULT_LEVEL = level;
 			for (auto it = LOG_LEVELS_MAP->begin(); it != LOG_LEVELS_MAP->end(); ++it) {
 				it->second = level;
 			}
@@ -38,14 +43,18 @@
 	}
 
 	esp_log_level_t esp_log_level_get(const char* tag) {
+		lock_guard<mutex> lock(LOG_LEVELS_LOCK);
 		auto it = LOG_LEVELS_MAP->find(string(tag));
-		
-		if (it == LOG_LEVELS_MAP->end()) {
-			// Create
-			(*LOG_LEVELS_MAP.get())[string(tag)] = ESP_LOG_NONE;
-		}
-		
-		return (*LOG_LEVELS_MAP.get())[string(tag)];
+		return (it == LOG_LEVELS_MAP->end() ? LOG_DEFAULT_LEVEL : it->second);
+	}
+
+	const esp_log_level_t* esp_log_level_handle(const char* tag) {
+		lock_guard<mutex> lock(LOG_LEVELS_LOCK);
+
+		// Map elements never move, so the pointer stays valid
+		auto it = LOG_LEVELS_MAP->find(string(tag));
+		if (it == LOG_LEVELS_MAP->end()) it = LOG_LEVELS_MAP->insert({ string(tag), LOG_DEFAULT_LEVEL }).first;
+		return &it->second;
 	}
 
 	void ESP_ERROR_CHECK(esp_err_t e) { /* do nothing */ }
@@ -85,12 +94,24 @@
 	}
 
 	uint64_t esp_timer_get_time() { 
-		// Should return microseconds!
-		auto clockPrecision = std::chrono::system_clock::now().time_since_epoch();
+		// Should return microseconds! Monotonic like ESP (system_clock can jump)
+		auto clockPrecision = std::chrono::steady_clock::now().time_since_epoch();
 		auto micros = std::chrono::duration_cast<std::chrono::microseconds>(clockPrecision);
 		return micros.count(); 
 	}
 
+	/** Pin a native thread to a CPU (modulo available CPUs) */
+	static void briand_pin_thread(const std::thread::native_handle_type& h, const int& core) {
+	#if defined(__linux__)
+		const unsigned int cpus = std::thread::hardware_concurrency();
+		if (core < 0 || core == tskNO_AFFINITY || cpus == 0) return;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(static_cast<unsigned int>(core) % cpus, &set);
+		pthread_setaffinity_np(h, sizeof(cpu_set_t), &set);
+	#endif
+	}
+
 	BaseType_t xTaskCreate(
 			TaskFunction_t pvTaskCode,
 			const char * const pcName,
@@ -98,10 +119,23 @@
 			void * const pvParameters,
 			UBaseType_t uxPriority,
 			TaskHandle_t * const pvCreatedTask)
+	{
+		return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, tskNO_AFFINITY);
+	}
+
+	BaseType_t xTaskCreatePinnedToCore(
+			TaskFunction_t pvTaskCode,
+			const char * const pcName,
+			const uint32_t usStackDepth,
+			void * const pvParameters,
+			UBaseType_t uxPriority,
+			TaskHandle_t * const pvCreatedTask,
+			const BaseType_t xCoreID)
 	{
 		// do not worry for prioriry and task depth now...
 
 		std::thread t(pvTaskCode, pvParameters);
+		if (xCoreID != tskNO_AFFINITY) briand_pin_thread(t.native_handle(), xCoreID);
 		TaskHandle_t tHandle = new BriandIDFPortingTaskHandle(t.native_handle(), pcName, t.get_id());
 
 		if (pvCreatedTask != NULL) {
@@ -168,23 +202,39 @@
 	}
 
 	esp_pthread_cfg_t esp_pthread_get_default_config(void) {
-		// Like the default configuration
+		// Like the default configuration (see sdkconfig)
 		esp_pthread_cfg_t defaults;
-		defaults.stack_size = 2048;
+		defaults.stack_size = 3072;
 		defaults.inherit_cfg = false;
-		defaults.pin_to_core = 0;
+		defaults.pin_to_core = tskNO_AFFINITY;
 		defaults.prio = 5;
 		defaults.thread_name = "pthread";
 		return defaults;
 	}
 
+	// Configuration is per-thread, like ESP
+	thread_local bool BRIAND_PTHREAD_CFG_SET = false;
+	thread_local esp_pthread_cfg_t BRIAND_PTHREAD_CFG;
+
 	esp_err_t esp_pthread_set_cfg(const esp_pthread_cfg_t *cfg) {
-		// do nothing
+		if (cfg == NULL) return ESP_FAIL;
+		// As ESP: a core number or tskNO_AFFINITY (cores beyond the available CPUs are taken modulo on Linux)
+		if (cfg->pin_to_core < 0 && cfg->pin_to_core != tskNO_AFFINITY) return ESP_ERR_INVALID_ARG;
+		BRIAND_PTHREAD_CFG = *cfg;
+		BRIAND_PTHREAD_CFG_SET = true;
 		return ESP_OK;
 	}
 
 	esp_err_t esp_pthread_get_cfg(esp_pthread_cfg_t *p) {
-		if (p != NULL) *p = esp_pthread_get_default_config();
+		if (p == NULL) return ESP_FAIL;
+		if (!BRIAND_PTHREAD_CFG_SET) return ESP_ERR_NOT_FOUND;
+		*p = BRIAND_PTHREAD_CFG;
+		return ESP_OK;
+	}
+
+	esp_err_t briand_pthread_apply_cfg(const esp_pthread_cfg_t *cfg) {
+		if (cfg == NULL) return ESP_FAIL;
+		briand_pin_thread(pthread_self(), cfg->pin_to_core);
 		return ESP_OK;
 	}
 
@@ -262,7 +312,7 @@
 			} 
 		}
 
-		LOG_LEVELS_MAP.reset();
+		// LOG_LEVELS_MAP is not freed: ESP_LOGx call sites keep pointers to its levels
 		BRIAND_TASK_POOL.reset();
 
 		cout << endl << endl << "*** All threads killed! Exiting. ***" << endl << endl;
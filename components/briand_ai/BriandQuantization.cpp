@@ -0,0 +1,181 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandQuantization.hxx"
+
+using namespace std;
+using namespace Briand;
+
+QuantizationParameters::QuantizationParameters() {
+    this->Scale = 1.0;
+    this->ZeroPoint = 0;
+}
+
+QuantizationParameters QuantizationParameters::FromRange(const double& min, const double& max) {
+    // Range must include zero (exact zero for padding, ReLU, zero bias)
+    const double low = (min < 0.0 ? min : 0.0);
+    const double high = (max > 0.0 ? max : 0.0);
+
+    QuantizationParameters p;
+    p.Scale = (high > low ? (high - low) / 255.0 : 1.0);
+    const double zero = round(-128.0 - low / p.Scale);
+    p.ZeroPoint = static_cast<int32_t>(zero < -128.0 ? -128.0 : (zero > 127.0 ? 127.0 : zero));
+
+    return p;
+}
+
+QuantizationObserver::QuantizationObserver() {
+    this->Reset();
+}
+
+void QuantizationObserver::Observe(const double* values, const size_t& n, const double& momentum) {
+    if (n == 0) return;
+
+    double min = values[0], max = values[0];
+    for (size_t i = 1; i < n; i++) {
+        if (values[i] < min) min = values[i];
+        if (values[i] > max) max = values[i];
+    }
+
+    if (!this->Initialized) {
+        this->Min = min;
+        this->Max = max;
+        this->Initialized = true;
+        return;
+    }
+
+    this->Min = (min < this->Min ? min : momentum * this->Min + (1.0 - momentum) * min);
+    this->Max = (max > this->Max ? max : momentum * this->Max + (1.0 - momentum) * max);
+}
+
+QuantizationParameters QuantizationObserver::Parameters() const {
+    return QuantizationParameters::FromRange(this->Min, this->Max);
+}
+
+void QuantizationObserver::Reset() {
+    this->Min = 0.0;
+    this->Max = 0.0;
+    this->Initialized = false;
+}
+
+void QuantizedLayer::QuantizeMultiplier(const double& value, int32_t& multiplier, int32_t& shift) {
+    // value = fraction * 2^exponent, fraction in [0.5, 1)
+    int exponent = 0;
+    const double fraction = frexp(value, &exponent);
+    int64_t q = static_cast<int64_t>(round(fraction * static_cast<double>(1LL << 31)));
+    if (q == (1LL << 31)) {
+        q /= 2;
+        exponent++;
+    }
+
+    multiplier = static_cast<int32_t>(q);
+    shift = -exponent;
+}
+
+QuantizedModel::QuantizedModel(vector<QuantizedLayer> layers) {
+    // Check
+    if (layers.size() == 0) throw runtime_error("QuantizedModel: at least one layer required.");
+
+    this->_layers = std::move(layers);
+
+    size_t widest = 0;
+    for (auto& l : this->_layers) widest = std::max(widest, std::max(l.Inputs, l.Outputs));
+    for (auto& b : this->_buffers) b.resize(widest);
+    this->_net.resize(this->_layers.back().Outputs);
+}
+
+size_t QuantizedModel::Inputs() const {
+    return this->_layers.front().Inputs;
+}
+
+size_t QuantizedModel::Outputs() const {
+    return this->_layers.back().Outputs;
+}
+
+const vector<QuantizedLayer>& QuantizedModel::Layers() const {
+    return this->_layers;
+}
+
+unique_ptr<vector<double>> QuantizedModel::Predict(const vector<double>& inputs) {
+    // Check
+    if (inputs.size() != this->Inputs()) throw out_of_range("QuantizedModel: invalid inputs size.");
+
+    // Quantize the input
+    int8_t* x = this->_buffers[0].data();
+    const auto& first = this->_layers.front();
+    for (size_t j = 0; j < inputs.size(); j++) x[j] = first.Input.Quantize(inputs[j]);
+
+    auto result = make_unique<vector<double>>(this->Outputs());
+
+    for (size_t k = 0; k < this->_layers.size(); k++) {
+        const auto& l = this->_layers[k];
+        const bool last = (k == this->_layers.size() - 1);
+        int8_t* y = this->_buffers[(k + 1) & 1].data();
+        const int8_t* w = l.Weights.data();
+
+        for (size_t i = 0; i < l.Outputs; i++, w += l.Inputs) {
+            // int32 accumulation: sum(w * (x - zp)) + bias
+            int32_t acc = 0;
+            for (size_t j = 0; j < l.Inputs; j++) acc += static_cast<int32_t>(w[j]) * static_cast<int32_t>(x[j]);
+            acc += l.Bias[i] - l.Input.ZeroPoint * l.RowSums[i];
+
+            // Requantize to the net value scale: acc * multiplier >> (31 + shift), rounded
+            const int32_t total = 31 + l.Shifts[i];
+            int64_t scaled = static_cast<int64_t>(acc) * static_cast<int64_t>(l.Multipliers[i]);
+            if (total >= 63) scaled = 0;
+            else if (total > 0) scaled = (scaled + (1LL << (total - 1))) >> total;
+            else if (total < 0 && scaled != 0) {
+                // Multiplier above 2^31 (net scale finer than the accumulator scale): shift left, saturating
+                const int32_t left = -total;
+                const int64_t limit = (left >= 32 ? 0 : (static_cast<int64_t>(1) << (62 - left)));
+                if (scaled >= limit) scaled = numeric_limits<int32_t>::max();
+                else if (scaled <= -limit) scaled = numeric_limits<int32_t>::min();
+                else scaled *= (static_cast<int64_t>(1) << left);
+            }
+            int64_t net = scaled + l.Net.ZeroPoint;
+            net = (net < -128 ? -128 : (net > 127 ? 127 : net));
+
+            if (last && l.Softmax) this->_net[i] = l.Net.Dequantize(static_cast<int32_t>(net));
+            else y[i] = l.Activation[net + 128];
+        }
+
+        if (last) {
+            if (l.Softmax) {
+                Math::SoftmaxInPlace(this->_net.data(), l.Outputs);
+                result->assign(this->_net.begin(), this->_net.end());
+            }
+            else for (size_t i = 0; i < l.Outputs; i++) result->at(i) = l.Output.Dequantize(y[i]);
+        }
+
+        x = y;
+    }
+
+    return std::move(result);
+}
+
+size_t QuantizedModel::MemoryUsage() const {
+    size_t bytes = sizeof(QuantizedModel);
+    for (auto& l : this->_layers) {
+        bytes += sizeof(QuantizedLayer);
+        bytes += l.Weights.capacity() * sizeof(int8_t);
+        bytes += l.WeightScales.capacity() * sizeof(double);
+        bytes += (l.Bias.capacity() + l.RowSums.capacity() + l.Multipliers.capacity() + l.Shifts.capacity()) * sizeof(int32_t);
+    }
+    for (auto& b : this->_buffers) bytes += b.capacity() * sizeof(int8_t);
+    bytes += this->_net.capacity() * sizeof(double);
+    return bytes;
+}
@@ -0,0 +1,455 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandRNN.hxx"
+
+using namespace std;
+using namespace Briand;
+
+RecurrentLayer::RecurrentLayer(const RecurrentCell& cell, const size_t& inputs, const size_t& hidden, const uint64_t& seed) {
+    // Check
+    if (inputs == 0 || hidden == 0) throw out_of_range("RecurrentLayer: inputs and hidden units must be > 0.");
+
+    this->_cell = cell;
+    this->_inputs = inputs;
+    this->_hidden = hidden;
+
+    const size_t rows = this->Gates() * hidden;
+    const size_t cols = inputs + hidden;
+
+    // Xavier/Glorot for sigmoid/tanh gates
+    this->_weights = make_unique<Matrix>(static_cast<int>(rows), static_cast<int>(cols));
+    this->_weights->RandomizeWeights(WeightInit::Xavier, Math::Tanh, cols, hidden, seed);
+
+    this->_bias.assign(rows, 0.0);
+    // LSTM: forget gate bias 1, remembers by default at the beginning of the training
+    if (cell == RecurrentCell::LSTM) std::fill_n(this->_bias.begin() + hidden, hidden, 1.0);
+    if (cell == RecurrentCell::GRU) this->_recurrentBias.assign(hidden, 0.0);
+
+    this->_h.assign(hidden, 0.0);
+    if (cell == RecurrentCell::LSTM) this->_c.assign(hidden, 0.0);
+    this->_concat.assign(cols, 0.0);
+    this->_gates.assign(rows, 0.0);
+    if (cell == RecurrentCell::GRU) this->_nh.assign(hidden, 0.0);
+}
+
+const vector<double>& RecurrentLayer::Step(const double* x, RecurrentStepCache* cache /* = nullptr */) {
+    const size_t H = this->_hidden;
+    const size_t I = this->_inputs;
+
+    std::copy_n(x, I, this->_concat.data());
+    std::copy_n(this->_h.data(), H, this->_concat.data() + I);
+    if (cache != nullptr) cache->Concat = this->_concat;
+
+    double* a = this->_gates.data();
+
+    if (this->_cell == RecurrentCell::LSTM) {
+        // All gates in one mat-vec on [x, h]
+        this->_weights->MultiplyVectorActivate(this->_concat.data(), this->_bias.data(), Math::Identity, a);
+
+        if (cache != nullptr) cache->Extra = this->_c;
+
+        for (size_t j = 0; j < H; j++) {
+            const double i = Math::Sigmoid(a[j]);
+            const double f = Math::Sigmoid(a[H + j]);
+            const double g = Math::Tanh(a[2*H + j]);
+            const double o = Math::Sigmoid(a[3*H + j]);
+            a[j] = i; a[H + j] = f; a[2*H + j] = g; a[3*H + j] = o;
+
+            this->_c[j] = f * this->_c[j] + i * g;
+            this->_h[j] = o * tanh(this->_c[j]);
+        }
+
+        if (cache != nullptr) cache->Cell = this->_c;
+    }
+    else {
+        // One pass on the fused matrix: z and r rows on [x, h], n rows split in input and recurrent parts (reset applies to the latter)
+        const double* in = this->_concat.data();
+        const double* h = in + I;
+        for (size_t row = 0; row < 2*H; row++) {
+            const double* w = (*this->_weights.get())[row];
+            double sum = this->_bias[row];
+            for (size_t k = 0; k < I + H; k++) sum += w[k] * in[k];
+            a[row] = Math::Sigmoid(sum);
+        }
+        for (size_t j = 0; j < H; j++) {
+            const double* w = (*this->_weights.get())[2*H + j];
+            double sx = this->_bias[2*H + j];
+            double sh = this->_recurrentBias[j];
+            for (size_t k = 0; k < I; k++) sx += w[k] * in[k];
+            for (size_t k = 0; k < H; k++) sh += w[I + k] * h[k];
+            this->_nh[j] = sh;
+            a[2*H + j] = Math::Tanh(sx + a[H + j] * sh);
+        }
+        for (size_t j = 0; j < H; j++) {
+            const double z = a[j];
+            this->_h[j] = (1.0 - z) * a[2*H + j] + z * h[j];
+        }
+
+        if (cache != nullptr) cache->Extra = this->_nh;
+    }
+
+    if (cache != nullptr) {
+        cache->Gates = this->_gates;
+        cache->Hidden = this->_h;
+    }
+
+    return this->_h;
+}
+
+void RecurrentLayer::Reset() {
+    std::fill(this->_h.begin(), this->_h.end(), 0.0);
+    std::fill(this->_c.begin(), this->_c.end(), 0.0);
+}
+
+void RecurrentLayer::Backward(const RecurrentStepCache& cache, const double* dh, double* dc, double* dx, double* dhPrev) {
+    const size_t H = this->_hidden;
+    const size_t I = this->_inputs;
+    const size_t cols = I + H;
+    const double* g = cache.Gates.data();
+
+    // Gradient buffers allocated by the first training step
+    if (this->_weightsGrad.empty()) {
+        this->_weightsGrad.assign(this->_weights->Rows() * cols, 0.0);
+        this->_biasGrad.assign(this->_bias.size(), 0.0);
+        this->_recurrentBiasGrad.assign(this->_recurrentBias.size(), 0.0);
+        this->_gatesGrad.assign(this->_bias.size() + H, 0.0);
+        this->_concatGrad.assign(cols, 0.0);
+    }
+    double* da = this->_gatesGrad.data();
+
+    // Gradient on [x, h_prev] from the gates, GRU adds the direct path z * h_prev
+    auto& dconcat = this->_concatGrad;
+    std::fill(dconcat.begin(), dconcat.end(), 0.0);
+
+    if (this->_cell == RecurrentCell::LSTM) {
+        for (size_t j = 0; j < H; j++) {
+            const double i = g[j], f = g[H + j], gg = g[2*H + j], o = g[3*H + j];
+            const double tc = tanh(cache.Cell[j]);
+            const double dcj = dc[j] + dh[j] * o * (1.0 - tc * tc);
+            da[j] = dcj * gg * i * (1.0 - i);
+            da[H + j] = dcj * cache.Extra[j] * f * (1.0 - f);
+            da[2*H + j] = dcj * i * (1.0 - gg * gg);
+            da[3*H + j] = dh[j] * tc * o * (1.0 - o);
+            dc[j] = dcj * f;
+        }
+
+        for (size_t row = 0; row < 4*H; row++) {
+            const double* w = (*this->_weights.get())[row];
+            double* gw = this->_weightsGrad.data() + row * cols;
+            const double d = da[row];
+            if (d == 0.0) continue;
+            for (size_t k = 0; k < cols; k++) {
+                gw[k] += d * cache.Concat[k];
+                dconcat[k] += d * w[k];
+            }
+            this->_biasGrad[row] += d;
+        }
+    }
+    else {
+        const double* hPrev = cache.Concat.data() + I;
+        // Recurrent part of the n gate (scaled by the reset gate) after the gates
+        double* dah = da + 3*H;
+        for (size_t j = 0; j < H; j++) {
+            const double z = g[j], r = g[H + j], n = g[2*H + j];
+            const double dan = dh[j] * (1.0 - z) * (1.0 - n * n);
+            da[j] = dh[j] * (hPrev[j] - n) * z * (1.0 - z);
+            da[H + j] = dan * cache.Extra[j] * r * (1.0 - r);
+            da[2*H + j] = dan;
+            dah[j] = dan * r;
+        }
+
+        for (size_t row = 0; row < 3*H; row++) {
+            const double* w = (*this->_weights.get())[row];
+            double* gw = this->_weightsGrad.data() + row * cols;
+            if (row < 2*H) {
+                const double d = da[row];
+                for (size_t k = 0; k < cols; k++) {
+                    gw[k] += d * cache.Concat[k];
+                    dconcat[k] += d * w[k];
+                }
+                this->_biasGrad[row] += d;
+            }
+            else {
+                const size_t j = row - 2*H;
+                const double d = da[row];
+                for (size_t k = 0; k < I; k++) {
+                    gw[k] += d * cache.Concat[k];
+                    dconcat[k] += d * w[k];
+                }
+                for (size_t k = I; k < cols; k++) {
+                    gw[k] += dah[j] * cache.Concat[k];
+                    dconcat[k] += dah[j] * w[k];
+                }
+                this->_biasGrad[row] += d;
+                this->_recurrentBiasGrad[j] += dah[j];
+            }
+        }
+
+        for (size_t j = 0; j < H; j++) dconcat[I + j] += dh[j] * g[j];
+    }
+
+    if (dx != nullptr) std::copy_n(dconcat.data(), I, dx);
+    std::copy_n(dconcat.data() + I, H, dhPrev);
+}
+
+double RecurrentLayer::GradientsSquaredNorm() const {
+    double sum = 0;
+    for (auto& v : this->_weightsGrad) sum += v * v;
+    for (auto& v : this->_biasGrad) sum += v * v;
+    for (auto& v : this->_recurrentBiasGrad) sum += v * v;
+    return sum;
+}
+
+void RecurrentLayer::ApplyGradients(const double& learningRate, const double& scale) {
+    if (this->_weightsGrad.empty()) return;
+
+    const double k = learningRate * scale;
+    const size_t cols = this->_weights->Cols();
+    for (size_t row = 0; row < this->_weights->Rows(); row++) {
+        double* w = (*this->_weights.get())[row];
+        double* gw = this->_weightsGrad.data() + row * cols;
+        for (size_t c = 0; c < cols; c++) {
+            w[c] -= k * gw[c];
+            gw[c] = 0.0;
+        }
+    }
+    for (size_t i = 0; i < this->_bias.size(); i++) { this->_bias[i] -= k * this->_biasGrad[i]; this->_biasGrad[i] = 0.0; }
+    for (size_t i = 0; i < this->_recurrentBias.size(); i++) { this->_recurrentBias[i] -= k * this->_recurrentBiasGrad[i]; this->_recurrentBiasGrad[i] = 0.0; }
+}
+
+size_t RecurrentLayer::Parameters() const {
+    return this->_weights->Rows() * this->_weights->Cols() + this->_bias.size() + this->_recurrentBias.size();
+}
+
+size_t RecurrentLayer::MemoryUsage() const {
+    size_t bytes = sizeof(RecurrentLayer);
+    bytes += this->_weights->MemoryUsage();
+    bytes += (this->_bias.capacity() + this->_recurrentBias.capacity() + this->_h.capacity() + this->_c.capacity() + this->_concat.capacity() + this->_gates.capacity() + this->_nh.capacity()) * sizeof(double);
+    bytes += (this->_weightsGrad.capacity() + this->_biasGrad.capacity() + this->_recurrentBiasGrad.capacity() + this->_gatesGrad.capacity() + this->_concatGrad.capacity()) * sizeof(double);
+    return bytes;
+}
+
+RecurrentNetwork::RecurrentNetwork(const size_t& inputs) {
+    // Check
+    if (inputs == 0) throw out_of_range("RecurrentNetwork: inputs must be > 0.");
+
+    this->_inputs = inputs;
+    this->_outWeights = nullptr;
+    this->_outActivation = nullptr;
+    this->_outDerivative = nullptr;
+    this->_outDerivativeNet = nullptr;
+    this->_error = nullptr;
+    this->_errorDerivative = nullptr;
+    this->_softmax = false;
+    this->_seed = 0;
+}
+
+void RecurrentNetwork::SetSeed(const uint64_t& seed) {
+    this->_seed = seed;
+}
+
+void RecurrentNetwork::AddRecurrentLayer(const size_t& hidden, const RecurrentCell& cell) {
+    // Check
+    if (this->_outWeights != nullptr) throw runtime_error("Cannot add recurrent layer after output layer!");
+
+    const size_t inputs = (this->_layers.empty() ? this->_inputs : this->_layers.back()->Hidden());
+    this->_layers.push_back(make_unique<RecurrentLayer>(cell, inputs, hidden, this->_seed + this->_layers.size() + 1));
+}
+
+void RecurrentNetwork::AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer) {
+    // Check
+    if (this->_outWeights != nullptr) throw runtime_error("Output layer has been added before.");
+    if (this->_layers.empty()) throw runtime_error("Cannot add output layer: missing a recurrent layer.");
+    if (outputs == 0) throw out_of_range("RecurrentNetwork: outputs must be > 0.");
+    if (activationFunc == Math::Softmax && errorFunc != Math::CrossEntropy) throw runtime_error("Softmax output requires CrossEntropy error function.");
+    if (activationFunc != Math::Softmax && activationDer == nullptr) throw runtime_error("Output layer requires the activation derivative.");
+
+    const size_t hidden = this->_layers.back()->Hidden();
+    this->_outWeights = make_unique<Matrix>(static_cast<int>(outputs), static_cast<int>(hidden));
+    this->_outWeights->RandomizeWeights(WeightInit::Xavier, activationFunc, hidden, outputs, this->_seed + this->_layers.size() + 1);
+    this->_outBias.assign(outputs, 0.0);
+
+    this->_softmax = (activationFunc == Math::Softmax);
+    this->_outActivation = (this->_softmax ? Math::Identity : activationFunc);
+    this->_outDerivative = (activationDer != nullptr ? Math::DerivativeFromOutput(activationDer) : nullptr);
+    this->_outDerivativeNet = activationDer;
+    this->_error = errorFunc;
+    this->_errorDerivative = errorFuncDer;
+    this->_outputs.assign(outputs, 0.0);
+    this->_outputsNet.assign(outputs, 0.0);
+}
+
+const vector<double>& RecurrentNetwork::Step(const vector<double>& x) {
+    // Check
+    if (x.size() != this->_inputs) throw runtime_error("Input values: invalid size.");
+    return this->Step(x.data());
+}
+
+const vector<double>& RecurrentNetwork::Step(const double* x) {
+    // Check
+    if (this->_outWeights == nullptr) throw runtime_error("Cannot step: missing an output layer.");
+
+    const double* in = x;
+    for (auto& l : this->_layers) in = l->Step(in).data();
+
+    this->_outWeights->MultiplyVectorActivate(in, this->_outBias.data(), this->_outActivation, this->_outputs.data());
+    if (this->_softmax) Math::SoftmaxInPlace(this->_outputs.data(), this->_outputs.size());
+
+    return this->_outputs;
+}
+
+void RecurrentNetwork::Reset() {
+    for (auto& l : this->_layers) l->Reset();
+}
+
+double RecurrentNetwork::TrainSequence(const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const double& learningRate, const size_t& truncation /* = 16 */, const double& clip /* = 5.0 */) {
+    BRIAND_TRACE_SCOPE("RecurrentNetwork::TrainSequence");
+
+    // Check
+    if (this->_outWeights == nullptr) throw runtime_error("Cannot train: missing an output layer.");
+    if (inputs.size() != targets.size()) throw out_of_range("Invalid targets: one for each timestep (empty for none).");
+    if (truncation == 0) throw out_of_range("Truncation must be > 0.");
+
+    const size_t L = this->_layers.size();
+    const size_t O = this->_outputs.size();
+    const size_t top = this->_layers.back()->Hidden();
+
+    // Chunk buffers, reused for all the chunks
+    vector<vector<RecurrentStepCache>> caches(L, vector<RecurrentStepCache>(std::min(truncation, inputs.size())));
+    vector<vector<double>> deltas(caches.empty() ? 0 : caches[0].size(), vector<double>(O));
+    vector<double> outWeightsGrad(O * top, 0.0), outBiasGrad(O, 0.0);
+    vector<vector<double>> dhNext(L), dcNext(L), dx(L), dhPrev(L);
+    for (size_t l = 0; l < L; l++) {
+        dhNext[l].resize(this->_layers[l]->Hidden());
+        dcNext[l].resize(this->_layers[l]->Hidden());
+        dx[l].resize(this->_layers[l]->Inputs());
+        dhPrev[l].resize(this->_layers[l]->Hidden());
+    }
+    vector<double> dhTop(top);
+
+    double error = 0;
+    size_t counted = 0;
+
+    this->Reset();
+
+    for (size_t begin = 0; begin < inputs.size(); begin += truncation) {
+        const size_t end = std::min(begin + truncation, inputs.size());
+
+        // Forward, keeping the values of each timestep
+        for (size_t t = begin; t < end; t++) {
+            if (inputs[t].size() != this->_inputs) throw runtime_error("Input values: invalid size.");
+
+            const double* in = inputs[t].data();
+            for (size_t l = 0; l < L; l++) in = this->_layers[l]->Step(in, &caches[l][t - begin]).data();
+
+            // Derivative not computable from the output value (custom functions): keep the net values, as FCNN does
+            const bool keepNet = (!this->_softmax && this->_outDerivative == nullptr);
+            if (keepNet) {
+                this->_outWeights->MultiplyVectorActivate(in, this->_outBias.data(), Math::Identity, this->_outputsNet.data());
+                for (size_t j = 0; j < O; j++) this->_outputs[j] = this->_outActivation(this->_outputsNet[j]);
+            }
+            else this->_outWeights->MultiplyVectorActivate(in, this->_outBias.data(), this->_outActivation, this->_outputs.data());
+            if (this->_softmax) Math::SoftmaxInPlace(this->_outputs.data(), O);
+
+            auto& delta = deltas[t - begin];
+            if (targets[t].empty()) {
+                std::fill(delta.begin(), delta.end(), 0.0);
+                continue;
+            }
+            if (targets[t].size() != O) throw out_of_range("Invalid targets: size must be equal to outputs.");
+
+            for (size_t j = 0; j < O; j++) {
+                const double y = this->_outputs[j];
+                error += this->_error(targets[t][j], y);
+                // Softmax with cross entropy: the output layer delta is y - t
+                if (this->_softmax) delta[j] = y - targets[t][j];
+                else delta[j] = this->_errorDerivative(targets[t][j], y) * (keepNet ? this->_outDerivativeNet(this->_outputsNet[j]) : this->_outDerivative(y));
+            }
+            counted++;
+        }
+
+        // Backward through the chunk only (truncation): state gradients start from zero
+        for (size_t l = 0; l < L; l++) {
+            std::fill(dhNext[l].begin(), dhNext[l].end(), 0.0);
+            std::fill(dcNext[l].begin(), dcNext[l].end(), 0.0);
+        }
+
+        for (size_t t = end; t-- > begin;) {
+            const auto& delta = deltas[t - begin];
+            const auto& h = caches[L - 1][t - begin].Hidden;
+
+            // Output layer
+            std::copy(dhNext[L - 1].begin(), dhNext[L - 1].end(), dhTop.begin());
+            for (size_t j = 0; j < O; j++) {
+                if (delta[j] == 0.0) continue;
+                const double* w = (*this->_outWeights.get())[j];
+                double* gw = outWeightsGrad.data() + j * top;
+                for (size_t k = 0; k < top; k++) {
+                    gw[k] += delta[j] * h[k];
+                    dhTop[k] += delta[j] * w[k];
+                }
+                outBiasGrad[j] += delta[j];
+            }
+
+            // Recurrent layers, top to bottom: hidden gradient from the layer above (same timestep) and from the next timestep
+            const double* dh = dhTop.data();
+            for (size_t l = L; l-- > 0;) {
+                if (l < L - 1) {
+                    for (size_t k = 0; k < dx[l + 1].size(); k++) dx[l + 1][k] += dhNext[l][k];
+                    dh = dx[l + 1].data();
+                }
+                this->_layers[l]->Backward(caches[l][t - begin], dh, dcNext[l].data(), (l > 0 ? dx[l].data() : nullptr), dhPrev[l].data());
+                dhNext[l].swap(dhPrev[l]);
+            }
+        }
+
+        // Clip the chunk gradient norm, then update
+        double norm = 0;
+        for (auto& v : outWeightsGrad) norm += v * v;
+        for (auto& v : outBiasGrad) norm += v * v;
+        for (auto& l : this->_layers) norm += l->GradientsSquaredNorm();
+        norm = sqrt(norm);
+        const double scale = (clip > 0 && norm > clip ? clip / norm : 1.0);
+
+        for (auto& l : this->_layers) l->ApplyGradients(learningRate, scale);
+        for (size_t j = 0; j < O; j++) {
+            double* w = (*this->_outWeights.get())[j];
+            double* gw = outWeightsGrad.data() + j * top;
+            for (size_t k = 0; k < top; k++) { w[k] -= learningRate * scale * gw[k]; gw[k] = 0.0; }
+            this->_outBias[j] -= learningRate * scale * outBiasGrad[j];
+            outBiasGrad[j] = 0.0;
+        }
+    }
+
+    return (counted > 0 ? error / static_cast<double>(counted) : 0.0);
+}
+
+size_t RecurrentNetwork::Parameters() const {
+    size_t n = 0;
+    for (auto& l : this->_layers) n += l->Parameters();
+    if (this->_outWeights != nullptr) n += this->_outWeights->Rows() * this->_outWeights->Cols() + this->_outBias.size();
+    return n;
+}
+
+size_t RecurrentNetwork::MemoryUsage() const {
+    size_t bytes = sizeof(RecurrentNetwork);
+    for (auto& l : this->_layers) bytes += l->MemoryUsage();
+    if (this->_outWeights != nullptr) bytes += this->_outWeights->MemoryUsage();
+    bytes += (this->_outBias.capacity() + this->_outputs.capacity() + this->_outputsNet.capacity()) * sizeof(double);
+    return bytes;
+}
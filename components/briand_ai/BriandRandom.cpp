@@ -0,0 +1,98 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandRandom.hxx"
+
+using namespace std;
+using namespace Briand;
+
+atomic<uint64_t> Random::_globalSeed(BRIAND_AI_RANDOM_SEED);
+atomic<uint64_t> Random::_generation(0);
+atomic<uint64_t> Random::_nextStream(0);
+
+Random::Random(const uint64_t& seed, const uint64_t& stream /* = 0 */) {
+    // State from SplitMix64, as suggested by xoshiro authors. Stream is mixed with the seed.
+    uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    state = SplitMix64(state) ^ stream;
+    for (int i = 0; i < 4; i++) this->_s[i] = SplitMix64(state);
+
+    this->_spare = 0.0;
+    this->_hasSpare = false;
+}
+
+uint64_t Random::SplitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+double Random::Normal(const double& mean /* = 0.0 */, const double& stddev /* = 1.0 */) {
+    if (this->_hasSpare) {
+        this->_hasSpare = false;
+        return mean + stddev * this->_spare;
+    }
+
+    // Box-Muller (1 - u so log argument is never 0)
+    const double u1 = 1.0 - this->Uniform();
+    const double u2 = this->Uniform();
+    const double r = sqrt(-2.0 * log(u1));
+    this->_spare = r * sin(2.0 * M_PI * u2);
+    this->_hasSpare = true;
+
+    return mean + stddev * r * cos(2.0 * M_PI * u2);
+}
+
+void Random::FillUniform(double* data, const size_t& n, const double& low /* = 0.0 */, const double& high /* = 1.0 */) {
+    const double range = high - low;
+    for (size_t i = 0; i < n; i++) data[i] = low + range * this->Uniform();
+}
+
+void Random::FillNormal(double* data, const size_t& n, const double& mean /* = 0.0 */, const double& stddev /* = 1.0 */) {
+    // Two values for each Box-Muller step
+    size_t i = 0;
+    for (; i + 1 < n; i += 2) {
+        const double u1 = 1.0 - this->Uniform();
+        const double u2 = this->Uniform();
+        const double r = stddev * sqrt(-2.0 * log(u1));
+        data[i] = mean + r * cos(2.0 * M_PI * u2);
+        data[i+1] = mean + r * sin(2.0 * M_PI * u2);
+    }
+    if (i < n) data[i] = this->Normal(mean, stddev);
+}
+
+void Random::Seed(const uint64_t& seed) {
+    _globalSeed = seed;
+    _nextStream = 0;
+    _generation++;
+}
+
+uint64_t Random::GlobalSeed() {
+    return _globalSeed;
+}
+
+Random& Random::ThreadLocal() {
+    static thread_local unique_ptr<Random> generator;
+    static thread_local uint64_t generation = 0;
+
+    if (generator == nullptr || generation != _generation) {
+        generation = _generation;
+        generator = make_unique<Random>(_globalSeed, _nextStream++);
+    }
+
+    return *generator.get();
+}
@@ -21,6 +21,8 @@
 using namespace std;
 using namespace Briand::SimpleNN;
 
+atomic<uint32_t> Briand::SimpleNN::Neuron::TopologyVersion(0);
+atomic<uint32_t> Briand::SimpleNN::Synapsis::WeightsVersion(0);
 
 Briand::SimpleNN::Neuron::Neuron() {
     this->Inputs = make_unique<vector<unique_ptr<Synapsis>>>();
@@ -59,12 +61,18 @@ void Briand::SimpleNN::Neuron::ConnectTo(const unique_ptr<Neuron>& other, double
 
     // Add synapsis (connect this neuron to the other)
     other->Inputs->push_back(std::move(syn));
+    TopologyVersion++;
 
     //
     // TODO: Should be verified that same connection is not existing!
     //
 }
 
+void Briand::SimpleNN::Synapsis::SetWeight(const double& weight) {
+    this->Weight = weight;
+    WeightsVersion++;
+}
+
 Briand::SimpleNN::NeuralLayer::NeuralLayer(const LayerType& type, ActivationFunction activationFunction) {
     // Initialize neurons with empty vector
     this->Neurons = make_unique<vector<unique_ptr<Neuron>>>();
@@ -84,6 +92,40 @@ Briand::SimpleNN::NeuralNetwork::NeuralNetwork() {
     // Do not do anything!
 }
 
+Briand::SimpleNN::NeuralNetwork::~NeuralNetwork() {
+    this->_plan.reset();
+}
+
+bool Briand::SimpleNN::NeuralNetwork::Compile() {
+    // If no input or output layer has neurons, throw an error
+    if (this->InputLayer == nullptr || this->InputLayer->Neurons->size() == 0) throw runtime_error("Briand::NeuralNetwork::Compile - no inputs");
+    if (this->OutputLayer == nullptr || this->OutputLayer->Neurons->size() == 0) throw runtime_error("Briand::NeuralNetwork::Compile - no outputs");
+
+    // The graph synapsis weights are the reference, the plan copies them
+    auto plan = make_unique<ExecutionPlan>(*this);
+
+    // Tiny networks run faster on the graph
+    if (plan->Synapses() < COMPILE_MIN_SYNAPSES) {
+        this->_plan.reset();
+        return false;
+    }
+
+    this->_plan = std::move(plan);
+    return true;
+}
+
+void Briand::SimpleNN::NeuralNetwork::Decompile() {
+    this->_plan.reset();
+}
+
+bool Briand::SimpleNN::NeuralNetwork::IsCompiled() const {
+    return this->_plan != nullptr;
+}
+
+Briand::SimpleNN::ExecutionPlan* Briand::SimpleNN::NeuralNetwork::GetPlan() const {
+    return this->_plan.get();
+}
+
 void Briand::SimpleNN::NeuralNetwork::PropagateForward() {
     // This must calculate values from inputs to outputs.
 
@@ -91,6 +133,16 @@ void Briand::SimpleNN::NeuralNetwork::PropagateForward() {
     if (this->InputLayer == nullptr || this->InputLayer->Neurons->size() == 0) throw runtime_error("Briand::NeuralNetwork::PropagateForward - no inputs");
     if (this->OutputLayer == nullptr || this->OutputLayer->Neurons->size() == 0) throw runtime_error("Briand::NeuralNetwork::PropagateForward - no outputs");
 
+    // If compiled, just run the plan (rebuilt or reloaded first if the graph has been edited)
+    if (this->_plan != nullptr) {
+        if (this->_plan->IsTopologyStale()) this->Compile();
+        else if (this->_plan->AreWeightsStale()) this->_plan->ReloadWeights();
+    }
+    if (this->_plan != nullptr) {
+        this->_plan->Execute();
+        return;
+    }
+
     // The UpdateValue method is meant to be "update my value with my inputs" for each neuron. So we have to start from the first
     // hidden layer or, if nothing, from the output layer
 
@@ -170,3 +222,131 @@ void Briand::SimpleNN::Perceptron::Train(const unique_ptr<vector<double>>& input
     // Backpropagate
     this->PropagateBackward(target);
 }
+
+Briand::SimpleNN::ExecutionPlan::ExecutionPlan(const NeuralNetwork& network) {
+    // Versions first: an edit during the build makes the plan stale, never silently current
+    this->_topologyVersion = Neuron::TopologyVersion;
+    this->_weightsVersion = Synapsis::WeightsVersion;
+
+    // Collect the neurons to be computed (same order as PropagateForward: hidden layers, then output layer).
+    // Neurons without inputs are never updated so they are not computed.
+    vector<pair<Neuron*, ActivationFunction>> computed;
+
+    if (network.HiddenLayers != nullptr) {
+        for (auto layer = network.HiddenLayers->begin(); layer != network.HiddenLayers->end(); layer++) {
+            for (auto neuron = layer->get()->Neurons->begin(); neuron != layer->get()->Neurons->end(); neuron++) {
+                if (neuron->get()->Inputs != nullptr && neuron->get()->Inputs->size() > 0) 
+                    computed.push_back({ neuron->get(), layer->get()->_activationFunction });
+            }
+        }
+    }
+
+    for (auto neuron = network.OutputLayer->Neurons->begin(); neuron != network.OutputLayer->Neurons->end(); neuron++) {
+        if (neuron->get()->Inputs != nullptr && neuron->get()->Inputs->size() > 0) 
+            computed.push_back({ neuron->get(), network.OutputLayer->_activationFunction });
+    }
+
+    // Index of each computed neuron
+    unordered_map<Neuron*, size_t> computedIndex;
+    for (size_t i = 0; i < computed.size(); i++) computedIndex[computed[i].first] = i;
+
+    // Source neurons index (everything feeding a computed neuron and not computed itself) 
+    unordered_map<Neuron*, size_t> sourceIndex;
+
+    // Topological sort (Kahn): count, for each computed neuron, how many inputs come from other computed neurons.
+    // Dependents lists are kept to release neurons once their inputs are ready.
+    vector<size_t> pending(computed.size(), 0);
+    vector<vector<size_t>> dependents(computed.size());
+    for (size_t i = 0; i < computed.size(); i++) {
+        for (auto syn = computed[i].first->Inputs->begin(); syn != computed[i].first->Inputs->end(); syn++) {
+            auto it = computedIndex.find(syn->get()->Source);
+            if (it != computedIndex.end()) {
+                pending[i]++;
+                dependents[it->second].push_back(i);
+            }
+            else if (sourceIndex.find(syn->get()->Source) == sourceIndex.end()) {
+                sourceIndex[syn->get()->Source] = this->_neurons.size();
+                this->_neurons.push_back(syn->get()->Source);
+            }
+        }
+    }
+
+    this->_sources = this->_neurons.size();
+
+    // Ready neurons are processed in original order (FIFO) so a layered network keeps its layer order
+    vector<size_t> order;
+    order.reserve(computed.size());
+    for (size_t i = 0; i < computed.size(); i++) if (pending[i] == 0) order.push_back(i);
+    for (size_t k = 0; k < order.size(); k++) {
+        for (auto& d : dependents[order[k]]) {
+            if (--pending[d] == 0) order.push_back(d);
+        }
+    }
+
+    if (order.size() != computed.size()) throw runtime_error("Briand::ExecutionPlan - the neuron graph has a cycle, cannot compile.");
+
+    // Place computed neurons after sources, in topological order
+    for (auto& i : order) {
+        computedIndex[computed[i].first] = this->_neurons.size();
+        this->_neurons.push_back(computed[i].first);
+        this->_activations.push_back(computed[i].second);
+    }
+
+    // Build CSR rows
+    this->_rowStart.reserve(order.size() + 1);
+    this->_rowStart.push_back(0);
+    for (auto& i : order) {
+        for (auto syn = computed[i].first->Inputs->begin(); syn != computed[i].first->Inputs->end(); syn++) {
+            auto it = computedIndex.find(syn->get()->Source);
+            this->_sourceIndex.push_back(it != computedIndex.end() ? it->second : sourceIndex[syn->get()->Source]);
+            this->_weights.push_back(syn->get()->Weight);
+            this->_synapses.push_back(syn->get());
+        }
+        this->_rowStart.push_back(this->_weights.size());
+    }
+
+    // Initial values
+    this->_values.resize(this->_neurons.size(), 0.0);
+}
+
+void Briand::SimpleNN::ExecutionPlan::Execute() {
+    // Gather source values
+    for (size_t i = 0; i < this->_sources; i++) this->_values[i] = this->_neurons[i]->Value;
+
+    // Raw pointers for the inner loop
+    double* values = this->_values.data();
+    const double* weights = this->_weights.data();
+    const size_t* source = this->_sourceIndex.data();
+    const size_t* rowStart = this->_rowStart.data();
+
+    const size_t computed = this->_activations.size();
+    for (size_t r = 0; r < computed; r++) {
+        double sum = 0.0;
+        for (size_t k = rowStart[r]; k < rowStart[r+1]; k++) sum += values[source[k]] * weights[k];
+        
+        // Activate and write back to graph
+        values[this->_sources + r] = this->_activations[r](sum);
+        this->_neurons[this->_sources + r]->Value = values[this->_sources + r];
+    }
+}
+
+void Briand::SimpleNN::ExecutionPlan::ReloadWeights() {
+    this->_weightsVersion = Synapsis::WeightsVersion;
+    for (size_t k = 0; k < this->_synapses.size(); k++) this->_weights[k] = this->_synapses[k]->Weight;
+}
+
+bool Briand::SimpleNN::ExecutionPlan::IsTopologyStale() const {
+    return this->_topologyVersion != Neuron::TopologyVersion;
+}
+
+bool Briand::SimpleNN::ExecutionPlan::AreWeightsStale() const {
+    return this->_weightsVersion != Synapsis::WeightsVersion;
+}
+
+size_t Briand::SimpleNN::ExecutionPlan::ComputedNeurons() const {
+    return this->_activations.size();
+}
+
+size_t Briand::SimpleNN::ExecutionPlan::Synapses() const {
+    return this->_weights.size();
+}
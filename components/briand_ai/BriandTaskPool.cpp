@@ -0,0 +1,246 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandTaskPool.hxx"
+
+using namespace std;
+using namespace Briand;
+
+/// @brief Pool owning the calling thread (nullptr if not a worker)
+static thread_local TaskPool* BRIAND_WORKER_POOL = nullptr;
+
+/// @brief Worker index of the calling thread
+static thread_local size_t BRIAND_WORKER_INDEX = 0;
+
+TaskPool::TaskPool(const size_t& workers /* = 0 */, const bool& pin /* = true */) {
+    size_t n = workers;
+    if (n == 0) {
+    #if defined(ESP_PLATFORM)
+        n = portNUM_PROCESSORS;
+    #else
+        n = std::thread::hardware_concurrency();
+    #endif
+        if (n == 0) n = 1;
+    }
+
+    this->_pending = 0;
+    this->_active = 0;
+    this->_next = 0;
+    this->_stop = false;
+
+    for (size_t i = 0; i < n; i++) this->_queues.push_back(make_unique<WorkerQueue>());
+
+#if defined(ESP_PLATFORM)
+    // Save the pthread configuration of the calling thread, workers are created with their own
+    esp_pthread_cfg_t previous;
+    bool hasPrevious = (esp_pthread_get_cfg(&previous) == ESP_OK);
+#endif
+
+    for (size_t i = 0; i < n; i++) {
+    #if defined(ESP_PLATFORM)
+        const int core = (pin ? static_cast<int>(i % portNUM_PROCESSORS) : tskNO_AFFINITY);
+    #else
+        // Linux porting pins modulo available CPUs
+        const int core = (pin ? static_cast<int>(i) : tskNO_AFFINITY);
+    #endif
+
+    #if defined(ESP_PLATFORM)
+        // On ESP the pthread is a FreeRTOS task created with this configuration
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = 4096;
+        cfg.thread_name = "briand_pool";
+        cfg.pin_to_core = core;
+        if (esp_pthread_set_cfg(&cfg) != ESP_OK) {
+            // Workers already created must be joined before throwing
+            this->StopWorkers();
+            if (hasPrevious) esp_pthread_set_cfg(&previous);
+            throw runtime_error("TaskPool: invalid worker thread configuration.");
+        }
+    #endif
+
+        this->_threads.push_back(std::thread(&TaskPool::WorkerLoop, this, i, core));
+    }
+
+#if defined(ESP_PLATFORM)
+    if (hasPrevious) esp_pthread_set_cfg(&previous);
+    else {
+        esp_pthread_cfg_t defaults = esp_pthread_get_default_config();
+        esp_pthread_set_cfg(&defaults);
+    }
+#endif
+}
+
+TaskPool::~TaskPool() {
+    this->StopWorkers();
+}
+
+void TaskPool::StopWorkers() {
+    {
+        lock_guard<mutex> lock(this->_sleepLock);
+        this->_stop = true;
+    }
+    this->_wake.notify_all();
+
+    for (auto& t : this->_threads) if (t.joinable()) t.join();
+}
+
+TaskPool& TaskPool::Default() {
+    static TaskPool pool;
+    return pool;
+}
+
+size_t TaskPool::Workers() const {
+    return this->_threads.size();
+}
+
+void TaskPool::WorkerLoop(const size_t index, const int core) {
+#if !defined(ESP_PLATFORM)
+    // On ESP the pin has been set at creation, here must be applied by the thread itself
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.pin_to_core = core;
+    briand_pthread_apply_cfg(&cfg);
+#endif
+
+    BRIAND_WORKER_POOL = this;
+    BRIAND_WORKER_INDEX = index;
+
+    if (Trace::IsEnabled()) Trace::SetThreadName(("briand_pool " + to_string(index)).c_str());
+
+    while (!this->_stop) {
+        if (this->RunOne(index)) continue;
+
+        // Nothing to do, sleep until a task is submitted
+        unique_lock<mutex> lock(this->_sleepLock);
+        this->_wake.wait(lock, [this] { return this->_stop || this->_pending > 0; });
+    }
+}
+
+bool TaskPool::RunOne(const size_t& index) {
+    function<void()> task;
+    const size_t n = this->_queues.size();
+
+    // Own queue first (back), then steal from the others (front)
+    for (size_t k = 0; k < n && !task; k++) {
+        auto& q = *this->_queues[(index + k) % n].get();
+        lock_guard<mutex> lock(q.Lock);
+        if (q.Tasks.empty()) continue;
+        if (k == 0) {
+            task = std::move(q.Tasks.back());
+            q.Tasks.pop_back();
+        }
+        else {
+            task = std::move(q.Tasks.front());
+            q.Tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+
+    this->_pending--;
+    {
+        BRIAND_TRACE_SCOPE("Task");
+        task();
+    }
+    this->_active--;
+
+    return true;
+}
+
+size_t TaskPool::CallerQueue() {
+    if (BRIAND_WORKER_POOL == this) return BRIAND_WORKER_INDEX;
+    return this->_next++ % this->_queues.size();
+}
+
+void TaskPool::Submit(function<void()> task) {
+    auto& q = *this->_queues[this->CallerQueue()].get();
+
+    this->_active++;
+    {
+        // Increment under the sleep lock so a worker going to sleep cannot miss it, and before the push so a running worker
+        // taking the task cannot decrement first
+        lock_guard<mutex> lock(this->_sleepLock);
+        this->_pending++;
+    }
+    {
+        lock_guard<mutex> lock(q.Lock);
+        q.Tasks.push_back(std::move(task));
+    }
+    this->_wake.notify_one();
+}
+
+void TaskPool::Wait() {
+    const size_t index = this->CallerQueue();
+    while (this->_active > 0) {
+        if (!this->RunOne(index)) std::this_thread::yield();
+    }
+}
+
+void TaskPool::ParallelFor(const size_t& begin, const size_t& end, const size_t& grain, const function<void(size_t, size_t)>& body) {
+    if (end <= begin) return;
+
+    // Chunks
+    const size_t total = end - begin;
+    size_t chunk = (grain == 0 ? (total + this->Workers() - 1) / this->Workers() : grain);
+    if (chunk == 0) chunk = 1;
+    const size_t chunks = (total + chunk - 1) / chunk;
+
+    // Nothing to parallelize
+    if (chunks == 1 || this->Workers() == 0) {
+        body(begin, end);
+        return;
+    }
+
+    atomic<size_t> remaining(chunks - 1);
+    exception_ptr error = nullptr;
+    mutex errorLock;
+
+    // Pending before the push, as Submit()
+    {
+        lock_guard<mutex> lock(this->_sleepLock);
+        this->_pending += chunks - 1;
+    }
+
+    // Queue all chunks except the first one, spread over the workers queues so they do not need to steal
+    for (size_t c = 1; c < chunks; c++) {
+        const size_t from = begin + c * chunk;
+        const size_t to = (from + chunk < end ? from + chunk : end);
+        auto& q = *this->_queues[c % this->_queues.size()].get();
+        this->_active++;
+        {
+            lock_guard<mutex> lock(q.Lock);
+            q.Tasks.push_back([&body, &remaining, &error, &errorLock, from, to] {
+                BRIAND_TRACE_SCOPE_ARG("ParallelFor chunk", static_cast<long>(from));
+                try { body(from, to); }
+                catch (...) { lock_guard<mutex> lock(errorLock); if (!error) error = current_exception(); }
+                remaining--;
+            });
+        }
+    }
+    this->_wake.notify_all();
+
+    // The caller runs the first chunk, then helps
+    BRIAND_TRACE_SCOPE("ParallelFor");
+    try { body(begin, (begin + chunk < end ? begin + chunk : end)); }
+    catch (...) { lock_guard<mutex> lock(errorLock); if (!error) error = current_exception(); }
+
+    const size_t index = this->CallerQueue();
+    while (remaining > 0) {
+        if (!this->RunOne(index)) std::this_thread::yield();
+    }
+
+    if (error) rethrow_exception(error);
+}
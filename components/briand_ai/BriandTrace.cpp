@@ -0,0 +1,115 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandTrace.hxx"
+
+using namespace std;
+using namespace Briand;
+
+atomic<bool> Trace::_enabled(false);
+size_t Trace::_bufferSize = 4096;
+vector<unique_ptr<TraceBuffer>> Trace::_buffers;
+mutex Trace::_buffersLock;
+
+/// @brief Buffer of the calling thread
+static thread_local TraceBuffer* BRIAND_TRACE_BUFFER = nullptr;
+
+TraceBuffer::TraceBuffer(const size_t& size, const size_t& threadNumber) : Events(size), Written(0), ThreadNumber(threadNumber) {
+    this->ThreadName = "thread " + to_string(threadNumber);
+}
+
+TraceBuffer* Trace::ThreadBuffer() {
+    if (BRIAND_TRACE_BUFFER == nullptr) {
+        lock_guard<mutex> lock(_buffersLock);
+        _buffers.push_back(make_unique<TraceBuffer>(_bufferSize, _buffers.size() + 1));
+        BRIAND_TRACE_BUFFER = _buffers.back().get();
+    }
+
+    return BRIAND_TRACE_BUFFER;
+}
+
+void Trace::Start(const size_t& eventsPerThread /* = 4096 */) {
+    if (eventsPerThread == 0) throw out_of_range("Trace::Start - events per thread must be > 0.");
+    _bufferSize = eventsPerThread;
+    _enabled = true;
+}
+
+void Trace::Stop() {
+    _enabled = false;
+}
+
+void Trace::Clear() {
+    lock_guard<mutex> lock(_buffersLock);
+    for (auto& b : _buffers) b->Written = 0;
+}
+
+void Trace::SetThreadName(const char* name) {
+    ThreadBuffer()->ThreadName = string(name);
+}
+
+void Trace::Record(const char* name, const uint64_t& begin, const uint64_t& end, const long& arg /* = -1 */) {
+    auto buffer = ThreadBuffer();
+    const size_t n = buffer->Written.load(std::memory_order_relaxed);
+
+    auto& e = buffer->Events[n % buffer->Events.size()];
+    e.Name = name;
+    e.Begin = begin;
+    e.End = end;
+    e.Arg = arg;
+
+    // Publish the event
+    buffer->Written.store(n + 1, std::memory_order_release);
+}
+
+void Trace::Write(FILE* out) {
+    lock_guard<mutex> lock(_buffersLock);
+
+    fprintf(out, "{\"traceEvents\":[\n");
+    bool first = true;
+
+    for (auto& b : _buffers) {
+        // Thread name (metadata event)
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", static_cast<unsigned long>(b->ThreadNumber), b->ThreadName.c_str());
+        first = false;
+
+        // Oldest to newest
+        const size_t written = b->Written.load(std::memory_order_acquire);
+        const size_t size = b->Events.size();
+        const size_t from = (written > size ? written - size : 0);
+
+        for (size_t i = from; i < written; i++) {
+            const auto& e = b->Events[i % size];
+            fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3lf,\"dur\":%.3lf", 
+                e.Name, 
+                static_cast<unsigned long>(b->ThreadNumber), 
+                static_cast<double>(e.Begin) / TicksPerMicrosecond(), 
+                static_cast<double>(e.End - e.Begin) / TicksPerMicrosecond());
+            if (e.Arg >= 0) fprintf(out, ",\"args\":{\"arg\":%ld}", e.Arg);
+            fprintf(out, "}");
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+}
+
+bool Trace::Save(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) return false;
+    Write(f);
+    fclose(f);
+    return true;
+}
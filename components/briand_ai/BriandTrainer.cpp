@@ -0,0 +1,182 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandTrainer.hxx"
+
+using namespace std;
+using namespace Briand;
+
+Trainer::Trainer(FCNN& fcnn) : _fcnn(fcnn) {
+    this->_learningRate = 0.1;
+    this->_schedule = LearningRateSchedule::Constant;
+    this->_decay = 0.5;
+    this->_step = 10;
+    this->_patience = 10;
+    this->_minDelta = 0.0;
+    this->_validationSplit = 0.2;
+    this->_seed = Random::GlobalSeed();
+}
+
+void Trainer::SetLearningRate(const double& learningRate, const LearningRateSchedule& schedule /* = LearningRateSchedule::Constant */, const double& decay /* = 0.5 */, const size_t& step /* = 10 */) {
+    // Check
+    if (learningRate <= 0.0) throw out_of_range("Trainer: learning rate must be > 0.");
+    if (step == 0) throw out_of_range("Trainer: step must be > 0.");
+
+    this->_learningRate = learningRate;
+    this->_schedule = schedule;
+    this->_decay = decay;
+    this->_step = step;
+}
+
+void Trainer::SetEarlyStopping(const size_t& patience, const double& minDelta /* = 0.0 */) {
+    this->_patience = patience;
+    this->_minDelta = minDelta;
+}
+
+void Trainer::SetValidationSplit(const double& fraction) {
+    if (fraction < 0.0 || fraction >= 1.0) throw out_of_range("Trainer: validation split must be between 0 and 1 (excluded).");
+    this->_validationSplit = fraction;
+}
+
+void Trainer::SetSeed(const uint64_t& seed) {
+    this->_seed = seed;
+}
+
+double Trainer::LearningRate(const size_t& epoch, const size_t& maxEpochs) const {
+    switch (this->_schedule) {
+        case LearningRateSchedule::Step: return this->_learningRate * pow(this->_decay, static_cast<double>(epoch / this->_step));
+        case LearningRateSchedule::Exponential: return this->_learningRate * pow(this->_decay, static_cast<double>(epoch));
+        case LearningRateSchedule::Cosine: return this->_learningRate * 0.5 * (1.0 + cos(M_PI * static_cast<double>(epoch) / static_cast<double>(maxEpochs)));
+        default: return this->_learningRate;
+    }
+}
+
+double Trainer::Evaluate(const InferenceModel& model, const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const vector<size_t>& indexes, const size_t& from, const size_t& to) const {
+    auto context = model.CreateContext();
+    double loss = 0.0;
+    for (size_t i = from; i < to; i++) {
+        auto y = model.Predict(inputs[indexes[i]], *context.get());
+        loss += this->_fcnn.Loss(*y.get(), targets[indexes[i]]);
+    }
+    return (to > from ? loss / static_cast<double>(to - from) : 0.0);
+}
+
+TrainResult Trainer::Fit(const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const size_t& maxEpochs) {
+    // Check
+    if (inputs.size() != targets.size() || inputs.size() == 0) throw runtime_error("Trainer: inputs and targets must have the same (not zero) size.");
+    if (maxEpochs == 0) throw out_of_range("Trainer: max epochs must be > 0.");
+
+    const uint64_t start = esp_timer_get_time();
+    Random generator(this->_seed);
+
+    // Index permutation: samples are never copied. Validation samples are the tail, chosen once.
+    vector<size_t> indexes(inputs.size());
+    for (size_t i = 0; i < indexes.size(); i++) indexes[i] = i;
+    auto shuffle = [&generator, &indexes](const size_t& from, const size_t& to) {
+        // Fisher-Yates
+        for (size_t i = to - 1; i > from; i--) std::swap(indexes[i], indexes[from + generator.Next() % (i - from + 1)]);
+    };
+    shuffle(0, indexes.size());
+
+    size_t trainSize = indexes.size() - static_cast<size_t>(this->_validationSplit * static_cast<double>(indexes.size()));
+    if (trainSize == 0) trainSize = 1;
+    const size_t validationFrom = (trainSize < indexes.size() ? trainSize : 0);
+
+    // The validation thread gets its own copy: with no validation split it validates on the training samples, 
+    // whose indexes are shuffled by the next epoch while it runs
+    const vector<size_t> validationIndexes(indexes.begin() + validationFrom, indexes.end());
+
+    TrainResult result;
+    result.Epochs = 0;
+    result.BestEpoch = 0;
+    result.BestValidationLoss = INFINITY;
+    result.StoppedEarly = false;
+    result.TimeToBest = 0;
+
+    // Best weights checkpoint (frozen snapshot)
+    unique_ptr<InferenceModel> best = nullptr;
+
+    // Validation of the previous epoch, running while the current one trains
+    unique_ptr<InferenceModel> pending = nullptr;
+    std::thread validation;
+    double pendingLoss = 0.0;
+    uint64_t pendingTime = 0;
+
+    // Join the validation on every exit path (Train() may throw), before the values it writes go out of scope
+    class ValidationJoin {
+        public:
+        std::thread& Thread;
+        ~ValidationJoin() { if (this->Thread.joinable()) this->Thread.join(); }
+    } validationJoin { validation };
+
+    // Collect the pending validation, true if training must stop
+    auto collect = [&]() {
+        if (pending == nullptr) return false;
+        validation.join();
+
+        const size_t epoch = result.ValidationLoss.size();
+        result.ValidationLoss.push_back(pendingLoss);
+
+        BRIAND_LOGD("BriandTrainer", "Epoch %lu: train loss %.6lf, validation loss %.6lf.", static_cast<unsigned long>(epoch), result.TrainLoss[epoch], pendingLoss);
+
+        if (pendingLoss < result.BestValidationLoss - this->_minDelta || best == nullptr) {
+            result.BestValidationLoss = pendingLoss;
+            result.BestEpoch = epoch;
+            result.TimeToBest = pendingTime;
+            best = std::move(pending);
+        }
+        pending.reset();
+
+        return (this->_patience > 0 && epoch - result.BestEpoch >= this->_patience);
+    };
+
+    for (size_t e = 0; e < maxEpochs; e++) {
+        BRIAND_TRACE_SCOPE_ARG("Trainer epoch", static_cast<long>(e));
+
+        // Train on the shuffled training samples
+        shuffle(0, trainSize);
+        const double lr = this->LearningRate(e, maxEpochs);
+        double loss = 0.0;
+        for (size_t i = 0; i < trainSize; i++) loss += this->_fcnn.Train(inputs[indexes[i]], targets[indexes[i]], lr);
+        result.TrainLoss.push_back(loss / static_cast<double>(trainSize));
+        result.Epochs = e + 1;
+
+        // Previous epoch validation has run meanwhile
+        if (collect()) {
+            result.StoppedEarly = true;
+            break;
+        }
+
+        // Validate this epoch in background on a snapshot, while the next one trains
+        pending = this->_fcnn.Freeze();
+        pendingTime = esp_timer_get_time() - start;
+        const InferenceModel* model = pending.get();
+        validation = std::thread([this, model, &inputs, &targets, validationIndexes, &pendingLoss] {
+            BRIAND_TRACE_SCOPE("Trainer validation");
+            pendingLoss = this->Evaluate(*model, inputs, targets, validationIndexes, 0, validationIndexes.size());
+        });
+    }
+
+    // Latest epoch
+    if (!result.StoppedEarly) collect();
+
+    // Back to the best weights
+    if (best != nullptr) this->_fcnn.Restore(*best.get());
+
+    result.Time = esp_timer_get_time() - start;
+    return result;
+}
@@ -0,0 +1,172 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BriandWindow.hxx"
+
+using namespace std;
+using namespace Briand;
+
+SlidingWindow::SlidingWindow(const size_t& length, const size_t& channels /* = 1 */) {
+    // Check
+    if (length == 0) throw out_of_range("SlidingWindow: length must be > 0.");
+    if (channels == 0) throw out_of_range("SlidingWindow: channels must be > 0.");
+
+    size_t n = 1;
+    while (n < length) n <<= 1;
+
+    this->_length = n;
+    this->_mask = n - 1;
+    this->_channels = channels;
+
+    this->_ring.resize(2 * n * channels);
+    this->_features.resize(channels * 5);
+    this->_mean.resize(channels);
+    this->_m2.resize(channels);
+    this->_energy.resize(channels);
+    this->_lapMean.resize(channels);
+    this->_lapM2.resize(channels);
+    this->_lapEnergy.resize(channels);
+    this->_minQueue.resize(n * channels);
+    this->_maxQueue.resize(n * channels);
+    this->_minHead.resize(channels);
+    this->_minTail.resize(channels);
+    this->_maxHead.resize(channels);
+    this->_maxTail.resize(channels);
+
+    this->Clear();
+}
+
+void SlidingWindow::Clear() {
+    std::fill(this->_ring.begin(), this->_ring.end(), 0.0);
+    std::fill(this->_features.begin(), this->_features.end(), 0.0);
+    std::fill(this->_mean.begin(), this->_mean.end(), 0.0);
+    std::fill(this->_m2.begin(), this->_m2.end(), 0.0);
+    std::fill(this->_energy.begin(), this->_energy.end(), 0.0);
+    std::fill(this->_lapMean.begin(), this->_lapMean.end(), 0.0);
+    std::fill(this->_lapM2.begin(), this->_lapM2.end(), 0.0);
+    std::fill(this->_lapEnergy.begin(), this->_lapEnergy.end(), 0.0);
+    std::fill(this->_minHead.begin(), this->_minHead.end(), 0);
+    std::fill(this->_minTail.begin(), this->_minTail.end(), 0);
+    std::fill(this->_maxHead.begin(), this->_maxHead.end(), 0);
+    std::fill(this->_maxTail.begin(), this->_maxTail.end(), 0);
+    this->_count = 0;
+}
+
+void SlidingWindow::Push(const double* sample) {
+    const uint64_t i = this->_count;
+    const size_t slot = static_cast<size_t>(i & this->_mask);
+    const bool full = (i >= this->_length);
+    const double n = static_cast<double>(full ? this->_length : i + 1);
+    // The lap started at slot 0: when it ends it holds exactly the window and its shadow sums replace the sliding ones,
+    // so rounding errors cannot accumulate (the shadow sums only add samples, O(1) each)
+    const double lapN = static_cast<double>(slot + 1);
+    const bool resync = (slot == this->_mask);
+
+    double* primary = this->_ring.data() + slot * this->_channels;
+    double* mirror = primary + this->_length * this->_channels;
+
+    for (size_t c = 0; c < this->_channels; c++) {
+        const double x = sample[c];
+        const double old = primary[c]; // The leaving sample when full
+        primary[c] = x;
+        mirror[c] = x;
+
+        // Mean and variance (Welford, sliding when full)
+        double& mean = this->_mean[c];
+        double& m2 = this->_m2[c];
+        if (full) {
+            const double d = x - old;
+            const double updated = mean + d / n;
+            m2 += d * (x - updated + old - mean);
+            mean = updated;
+            this->_energy[c] += x * x - old * old;
+        }
+        else {
+            const double d = x - mean;
+            mean += d / n;
+            m2 += d * (x - mean);
+            this->_energy[c] += x * x;
+        }
+
+        // Shadow sums of the lap (Welford, adding only)
+        double& lapMean = this->_lapMean[c];
+        double& lapM2 = this->_lapM2[c];
+        double& lapEnergy = this->_lapEnergy[c];
+        if (slot == 0) {
+            lapMean = x;
+            lapM2 = 0.0;
+            lapEnergy = x * x;
+        }
+        else {
+            const double d = x - lapMean;
+            lapMean += d / lapN;
+            lapM2 += d * (x - lapMean);
+            lapEnergy += x * x;
+        }
+
+        if (resync) {
+            mean = lapMean;
+            m2 = lapM2;
+            this->_energy[c] = lapEnergy;
+        }
+
+        // Min and max: drop the leaving sample from the queue heads, the dominated samples from the tails
+        uint64_t* minQueue = this->_minQueue.data() + c * this->_length;
+        uint64_t* maxQueue = this->_maxQueue.data() + c * this->_length;
+        uint64_t& minHead = this->_minHead[c];
+        uint64_t& minTail = this->_minTail[c];
+        uint64_t& maxHead = this->_maxHead[c];
+        uint64_t& maxTail = this->_maxTail[c];
+
+        if (full) {
+            if (minHead < minTail && minQueue[minHead & this->_mask] + this->_length <= i) minHead++;
+            if (maxHead < maxTail && maxQueue[maxHead & this->_mask] + this->_length <= i) maxHead++;
+        }
+        while (minTail > minHead && this->At(minQueue[(minTail - 1) & this->_mask], c) >= x) minTail--;
+        while (maxTail > maxHead && this->At(maxQueue[(maxTail - 1) & this->_mask], c) <= x) maxTail--;
+        minQueue[(minTail++) & this->_mask] = i;
+        maxQueue[(maxTail++) & this->_mask] = i;
+
+        double* f = this->_features.data() + c * 5;
+        f[static_cast<size_t>(WindowFeature::Mean)] = mean;
+        f[static_cast<size_t>(WindowFeature::Variance)] = (m2 > 0.0 ? m2 / n : 0.0); // m2 may round slightly below zero between resyncs
+        f[static_cast<size_t>(WindowFeature::Min)] = this->At(minQueue[minHead & this->_mask], c);
+        f[static_cast<size_t>(WindowFeature::Max)] = this->At(maxQueue[maxHead & this->_mask], c);
+        f[static_cast<size_t>(WindowFeature::Energy)] = this->_energy[c];
+    }
+
+    this->_count++;
+}
+
+WindowView SlidingWindow::View() const {
+    WindowView view;
+    // Oldest sample is the next to be overwritten, the mirror makes the following _length samples contiguous
+    view.Samples = this->_ring.data() + static_cast<size_t>(this->_count & this->_mask) * this->_channels;
+    view.Length = this->_length;
+    view.Channels = this->_channels;
+    view.Features = this->_features.data();
+    return view;
+}
+
+size_t SlidingWindow::MemoryUsage() const {
+    size_t bytes = sizeof(SlidingWindow);
+    bytes += (this->_ring.capacity() + this->_features.capacity() + this->_mean.capacity() + this->_m2.capacity() + this->_energy.capacity()) * sizeof(double);
+    bytes += (this->_lapMean.capacity() + this->_lapM2.capacity() + this->_lapEnergy.capacity()) * sizeof(double);
+    bytes += (this->_minQueue.capacity() + this->_maxQueue.capacity()) * sizeof(uint64_t);
+    bytes += (this->_minHead.capacity() + this->_minTail.capacity() + this->_maxHead.capacity() + this->_maxTail.capacity()) * sizeof(uint64_t);
+    return bytes;
+}
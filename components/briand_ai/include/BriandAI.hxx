@@ -22,11 +22,24 @@
 /* Library headers all-in-one for in-project include */
 
 #include "BriandInclude.hxx"
+#include "BriandLog.hxx"
+#include "BriandTrace.hxx"
+#include "BriandTaskPool.hxx"
+#include "BriandKernelProfile.hxx"
+#include "BriandRandom.hxx"
 #include "BriandMath.hxx"
 #include "BriandMatrix.hxx"
+#include "BriandWindow.hxx"
+#include "BriandExpression.hxx"
 #include "BriandImage.hxx"
 #include "BriandSimpleNN.hxx"
+#include "BriandInferenceModel.hxx"
+#include "BriandQuantization.hxx"
 #include "BriandFCNN.hxx"
+#include "BriandPipeline.hxx"
+#include "BriandKernelTuner.hxx"
+#include "BriandTrainer.hxx"
 #include "BriandCNN.hxx"
+#include "BriandRNN.hxx"
 
 #endif
\ No newline at end of file
@@ -21,9 +21,174 @@
 #define BRIAND_CNN_H
 
 #include "BriandInclude.hxx"
+#include "BriandMath.hxx"
+#include "BriandMatrix.hxx"
+#include "BriandRandom.hxx"
+#include "BriandTrace.hxx"
+
+using namespace std;
 
 namespace Briand {
-    
+
+    /** @brief Causal 1D convolution over time (TCN style): the output at time t depends on the inputs at t, t - d, ..., t - (K-1)*d 
+        (K kernel size, d dilation), inputs before the first one are zeros.
+        Batch mode convolves a whole sequence (one row per timestep). Streaming mode keeps a ring of the past inputs and computes 
+        only the output of the new timestep for each sample: same results as the batch mode on the whole stream.
+    */
+    class Conv1D {
+        protected:
+
+        /// @brief Input channels
+        size_t _inputChannels;
+
+        /// @brief Kernel size (taps)
+        size_t _kernelSize;
+
+        /// @brief Dilation (timesteps between taps)
+        size_t _dilation;
+
+        /// @brief Weights, one row for each output channel, column k * inputs + c is tap k (k = K-1 is the newest input) of input channel c
+        unique_ptr<Matrix> _weights;
+
+        /// @brief Bias, one for each output channel
+        vector<double> _bias;
+
+        /// @brief Activation function
+        ActivationFunction _activation;
+
+        /// @brief Streaming: ring of past inputs (power of two rows of _inputChannels values, covers the receptive field)
+        vector<double> _history;
+
+        /// @brief Streaming: ring rows - 1
+        size_t _historyMask;
+
+        /// @brief Streaming: samples pushed
+        uint64_t _count;
+
+        /// @brief Taps of the current timestep gathered contiguously (K * input channels)
+        vector<double> _taps;
+
+        public:
+
+        /// @brief Build a layer with given weights
+        /// @param inputChannels Input channels
+        /// @param kernelSize Kernel size (taps)
+        /// @param dilation Dilation (1 = contiguous taps)
+        /// @param activation Activation function
+        /// @param weights Weights (output channels rows, kernelSize * inputChannels cols)
+        /// @param bias Bias (one for each output channel, empty for zeros)
+        Conv1D(const size_t& inputChannels, const size_t& kernelSize, const size_t& dilation, const ActivationFunction& activation, const Matrix& weights, const vector<double>& bias = {});
+
+        /// @brief Build a layer with random weights and zero bias
+        /// @param inputChannels Input channels
+        /// @param outputChannels Output channels (filters)
+        /// @param kernelSize Kernel size (taps)
+        /// @param dilation Dilation (1 = contiguous taps)
+        /// @param activation Activation function
+        /// @param seed Weights seed
+        /// @param init Weights initialization (Auto: He for ReLU, Xavier otherwise)
+        Conv1D(const size_t& inputChannels, const size_t& outputChannels, const size_t& kernelSize, const size_t& dilation, const ActivationFunction& activation, const uint64_t& seed, const WeightInit& init = WeightInit::Auto);
+
+        /// @brief Input channels
+        inline size_t InputChannels() const { return this->_inputChannels; }
+
+        /// @brief Output channels
+        inline size_t OutputChannels() const { return this->_weights->Rows(); }
+
+        /// @brief Kernel size
+        inline size_t KernelSize() const { return this->_kernelSize; }
+
+        /// @brief Dilation
+        inline size_t Dilation() const { return this->_dilation; }
+
+        /// @brief Receptive field in timesteps: (K-1)*d + 1
+        inline size_t ReceptiveField() const { return (this->_kernelSize - 1) * this->_dilation + 1; }
+
+        /// @brief Weights
+        inline const Matrix& Weights() const { return *this->_weights.get(); }
+
+        /// @brief Batch mode: convolve a sequence
+        /// @param input Sequence, one row for each timestep (input channels cols)
+        /// @return Output sequence, one row for each timestep (output channels cols)
+        unique_ptr<Matrix> Forward(const Matrix& input);
+
+        /// @brief Streaming mode: push the input of a new timestep and compute its output only
+        /// @param x Input channels values
+        /// @param y Output channels values (result)
+        void Step(const double* x, double* y);
+
+        /// @brief Streaming mode: forget the past inputs (the next Step() is the first timestep)
+        void Reset();
+
+        /// @brief Memory used in bytes
+        size_t MemoryUsage() const;
+    };
+
+    /** @brief A stack of causal Conv1D layers (temporal convolutional network) with batch and streaming inference.
+        In streaming mode each layer keeps the ring of its past input activations, so a new sample costs one output timestep per layer.
+    */
+    class Conv1DNetwork {
+        protected:
+
+        /// @brief Input channels
+        size_t _inputChannels;
+
+        /// @brief Layers
+        vector<unique_ptr<Conv1D>> _layers;
+
+        /// @brief Streaming: output of each layer for the current timestep
+        vector<vector<double>> _activations;
+
+        /// @brief Weights seed
+        uint64_t _seed;
+
+        public:
+
+        /// @brief Build an empty network
+        /// @param inputChannels Input channels
+        Conv1DNetwork(const size_t& inputChannels);
+
+        /// @brief Set the seed for random weights of the next layers
+        /// @param seed Seed
+        void SetSeed(const uint64_t& seed);
+
+        /// @brief Add a layer with random weights
+        /// @param outputChannels Output channels (filters)
+        /// @param kernelSize Kernel size (taps)
+        /// @param dilation Dilation (TCN: 1, 2, 4, ...)
+        /// @param activation Activation function
+        /// @param init Weights initialization
+        void AddLayer(const size_t& outputChannels, const size_t& kernelSize, const size_t& dilation, const ActivationFunction& activation, const WeightInit& init = WeightInit::Auto);
+
+        /// @brief Add a layer with given weights
+        /// @param layer Layer (input channels must be the output channels of the last layer)
+        void AddLayer(unique_ptr<Conv1D> layer);
+
+        /// @brief Layers
+        inline const vector<unique_ptr<Conv1D>>& Layers() const { return this->_layers; }
+
+        /// @brief Output channels (of the last layer)
+        size_t OutputChannels() const;
+
+        /// @brief Receptive field in timesteps: an output depends on this many past inputs (included the current one)
+        size_t ReceptiveField() const;
+
+        /// @brief Batch mode: run a sequence through all layers
+        /// @param input Sequence, one row for each timestep (input channels cols)
+        /// @return Output sequence, one row for each timestep
+        unique_ptr<Matrix> Forward(const Matrix& input);
+
+        /// @brief Streaming mode: push a new sample through all layers
+        /// @param x Input channels values
+        /// @return Output of the last layer for this timestep (valid until the next Step())
+        const vector<double>& Step(const double* x);
+
+        /// @brief Streaming mode: forget the past of all layers
+        void Reset();
+
+        /// @brief Memory used in bytes
+        size_t MemoryUsage() const;
+    };
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,334 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_EXPRESSION_H
+#define BRIAND_EXPRESSION_H
+
+#include "BriandInclude.hxx"
+#include "BriandMatrix.hxx"
+#include "BriandTaskPool.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Lazy vector and matrix arithmetic (expression templates). 
+        An expression like Map(f, Ref(W) * Ref(x) + Ref(b)) only builds a small object on the stack: nothing is computed 
+        until Assign() runs it in a single loop, element by element, without temporaries.
+        Leaves (Ref) only point to the data, so the data must live as long as the expression.
+        Destination of Assign() must not be an operand of a matrix-vector product (elementwise operands are safe: W = W - k*Outer(d, a) is fine).
+        A matrix-vector product reads each operand element once for every row: an operand containing another product, 
+        like v in Ref(W2) * (Ref(W1) * Ref(x)), would be recomputed for every row (O(n^3)), so it is evaluated once into a 
+        temporary vector when the expression is built (the only case with a temporary).
+    */
+    namespace Expression {
+
+        /** @brief Base of vector expressions (CRTP) */
+        template<class E> class VectorExpression {
+            public:
+            inline const E& Self() const { return static_cast<const E&>(*this); }
+            inline double operator[](const size_t& i) const { return this->Self()[i]; }
+            inline size_t Size() const { return this->Self().Size(); }
+        };
+
+        /** @brief Base of matrix expressions (CRTP) */
+        template<class E> class MatrixExpression {
+            public:
+            inline const E& Self() const { return static_cast<const E&>(*this); }
+            inline double operator()(const size_t& i, const size_t& j) const { return this->Self()(i, j); }
+            inline size_t Rows() const { return this->Self().Rows(); }
+            inline size_t Cols() const { return this->Self().Cols(); }
+        };
+
+        /*
+            Leaves
+        */
+
+        /** @brief Vector data */
+        class VectorRef : public VectorExpression<VectorRef> {
+            protected:
+            const double* _data;
+            size_t _size;
+
+            public:
+            VectorRef(const double* data, const size_t& size) : _data(data), _size(size) {}
+            inline double operator[](const size_t& i) const { return this->_data[i]; }
+            inline size_t Size() const { return this->_size; }
+        };
+
+        /** @brief Matrix data */
+        class MatrixRef : public MatrixExpression<MatrixRef> {
+            protected:
+            const Matrix& _m;
+
+            public:
+            MatrixRef(const Matrix& m) : _m(m) {}
+            inline double operator()(const size_t& i, const size_t& j) const { return this->_m[i][j]; }
+            inline size_t Rows() const { return this->_m.Rows(); }
+            inline size_t Cols() const { return this->_m.Cols(); }
+            inline const Matrix& Data() const { return this->_m; }
+        };
+
+        /** @brief Transposed matrix data (only usable in a matrix-vector product) */
+        class TransposedRef {
+            protected:
+            const Matrix& _m;
+
+            public:
+            TransposedRef(const Matrix& m) : _m(m) {}
+            inline const Matrix& Data() const { return this->_m; }
+        };
+
+        inline VectorRef Ref(const vector<double>& v) { return VectorRef(v.data(), v.size()); }
+        inline VectorRef Ref(const double* data, const size_t& size) { return VectorRef(data, size); }
+        inline MatrixRef Ref(const Matrix& m) { return MatrixRef(m); }
+        inline TransposedRef Transpose(const MatrixRef& m) { return TransposedRef(m.Data()); }
+
+        /*
+            Operations
+        */
+
+        /** @brief Elementwise operations */
+        class Plus { public: static inline double Apply(const double& a, const double& b) { return a + b; } };
+        class Minus { public: static inline double Apply(const double& a, const double& b) { return a - b; } };
+        class Times { public: static inline double Apply(const double& a, const double& b) { return a * b; } };
+
+        /** @brief Elementwise binary vector operation */
+        template<class L, class R, class Op> class VectorBinary : public VectorExpression<VectorBinary<L, R, Op>> {
+            protected:
+            const L _l;
+            const R _r;
+
+            public:
+            VectorBinary(const L& l, const R& r) : _l(l), _r(r) {
+                if (l.Size() != r.Size()) throw out_of_range("Expression: vector sizes mismatch.");
+            }
+            inline double operator[](const size_t& i) const { return Op::Apply(this->_l[i], this->_r[i]); }
+            inline size_t Size() const { return this->_l.Size(); }
+        };
+
+        /** @brief Vector multiplied by a scalar */
+        template<class E> class VectorScale : public VectorExpression<VectorScale<E>> {
+            protected:
+            const E _e;
+            const double _k;
+
+            public:
+            VectorScale(const E& e, const double& k) : _e(e), _k(k) {}
+            inline double operator[](const size_t& i) const { return this->_k * this->_e[i]; }
+            inline size_t Size() const { return this->_e.Size(); }
+        };
+
+        /** @brief Function applied to each element (function pointer like ActivationFunction or functor) */
+        template<class F, class E> class VectorMap : public VectorExpression<VectorMap<F, E>> {
+            protected:
+            const F _f;
+            const E _e;
+
+            public:
+            VectorMap(const F& f, const E& e) : _f(f), _e(e) {}
+            inline double operator[](const size_t& i) const { return this->_f(this->_e[i]); }
+            inline size_t Size() const { return this->_e.Size(); }
+        };
+
+        template<class E> class MatrixVectorProduct;
+        template<class E> class TransposedVectorProduct;
+
+        /** @brief True if the expression contains a matrix-vector product */
+        template<class E> class HasProduct { public: static const bool Value = false; };
+        template<class E> class HasProduct<MatrixVectorProduct<E>> { public: static const bool Value = true; };
+        template<class E> class HasProduct<TransposedVectorProduct<E>> { public: static const bool Value = true; };
+        template<class L, class R, class Op> class HasProduct<VectorBinary<L, R, Op>> { public: static const bool Value = HasProduct<L>::Value || HasProduct<R>::Value; };
+        template<class E> class HasProduct<VectorScale<E>> { public: static const bool Value = HasProduct<E>::Value; };
+        template<class F, class E> class HasProduct<VectorMap<F, E>> { public: static const bool Value = HasProduct<E>::Value; };
+
+        /** @brief Vector operand of a matrix-vector product: kept lazy */
+        template<class E, bool Evaluate = HasProduct<E>::Value> class ProductOperand {
+            protected:
+            const E _e;
+
+            public:
+            ProductOperand(const E& e) : _e(e) {}
+            inline double operator[](const size_t& i) const { return this->_e[i]; }
+            inline size_t Size() const { return this->_e.Size(); }
+        };
+
+        /** @brief Vector operand of a matrix-vector product containing another product: evaluated once (shared by the copies of the expression) */
+        template<class E> class ProductOperand<E, true> {
+            protected:
+            shared_ptr<const vector<double>> _values;
+
+            public:
+            ProductOperand(const E& e) {
+                auto values = make_shared<vector<double>>(e.Size());
+                for (size_t i = 0; i < values->size(); i++) (*values)[i] = e[i];
+                this->_values = std::move(values);
+            }
+            inline double operator[](const size_t& i) const { return (*this->_values)[i]; }
+            inline size_t Size() const { return this->_values->size(); }
+        };
+
+        /** @brief Matrix-vector product W*v (element i is the dot product of row i and v) */
+        template<class E> class MatrixVectorProduct : public VectorExpression<MatrixVectorProduct<E>> {
+            protected:
+            const Matrix& _m;
+            const ProductOperand<E> _v;
+
+            public:
+            MatrixVectorProduct(const Matrix& m, const E& v) : _m(m), _v(v) {
+                if (m.Cols() != v.Size()) throw out_of_range("Expression: matrix cols and vector size mismatch.");
+            }
+            inline double operator[](const size_t& i) const {
+                const double* row = this->_m[i];
+                const size_t n = this->_m.Cols();
+                double sum = 0.0;
+                for (size_t j = 0; j < n; j++) sum += row[j] * this->_v[j];
+                return sum;
+            }
+            inline size_t Size() const { return this->_m.Rows(); }
+        };
+
+        /** @brief Transposed matrix-vector product W_T*v (element j is the dot product of column j and v, the transposed matrix is never built) */
+        template<class E> class TransposedVectorProduct : public VectorExpression<TransposedVectorProduct<E>> {
+            protected:
+            const Matrix& _m;
+            const ProductOperand<E> _v;
+
+            public:
+            TransposedVectorProduct(const Matrix& m, const E& v) : _m(m), _v(v) {
+                if (m.Rows() != v.Size()) throw out_of_range("Expression: matrix rows and vector size mismatch.");
+            }
+            inline double operator[](const size_t& j) const {
+                const size_t n = this->_m.Rows();
+                double sum = 0.0;
+                for (size_t i = 0; i < n; i++) sum += this->_m[i][j] * this->_v[i];
+                return sum;
+            }
+            inline size_t Size() const { return this->_m.Cols(); }
+        };
+
+        /** @brief Elementwise binary matrix operation */
+        template<class L, class R, class Op> class MatrixBinary : public MatrixExpression<MatrixBinary<L, R, Op>> {
+            protected:
+            const L _l;
+            const R _r;
+
+            public:
+            MatrixBinary(const L& l, const R& r) : _l(l), _r(r) {
+                if (l.Rows() != r.Rows() || l.Cols() != r.Cols()) throw out_of_range("Expression: matrix sizes mismatch.");
+            }
+            inline double operator()(const size_t& i, const size_t& j) const { return Op::Apply(this->_l(i, j), this->_r(i, j)); }
+            inline size_t Rows() const { return this->_l.Rows(); }
+            inline size_t Cols() const { return this->_l.Cols(); }
+        };
+
+        /** @brief Matrix multiplied by a scalar */
+        template<class E> class MatrixScale : public MatrixExpression<MatrixScale<E>> {
+            protected:
+            const E _e;
+            const double _k;
+
+            public:
+            MatrixScale(const E& e, const double& k) : _e(e), _k(k) {}
+            inline double operator()(const size_t& i, const size_t& j) const { return this->_k * this->_e(i, j); }
+            inline size_t Rows() const { return this->_e.Rows(); }
+            inline size_t Cols() const { return this->_e.Cols(); }
+        };
+
+        /** @brief Outer product a*b_T (element i,j is a[i]*b[j]) */
+        template<class L, class R> class OuterProduct : public MatrixExpression<OuterProduct<L, R>> {
+            protected:
+            const L _a;
+            const R _b;
+
+            public:
+            OuterProduct(const L& a, const R& b) : _a(a), _b(b) {}
+            inline double operator()(const size_t& i, const size_t& j) const { return this->_a[i] * this->_b[j]; }
+            inline size_t Rows() const { return this->_a.Size(); }
+            inline size_t Cols() const { return this->_b.Size(); }
+        };
+
+        /*
+            Operators and functions building expressions
+        */
+
+        template<class L, class R> inline VectorBinary<L, R, Plus> operator+(const VectorExpression<L>& l, const VectorExpression<R>& r) { return VectorBinary<L, R, Plus>(l.Self(), r.Self()); }
+        template<class L, class R> inline VectorBinary<L, R, Minus> operator-(const VectorExpression<L>& l, const VectorExpression<R>& r) { return VectorBinary<L, R, Minus>(l.Self(), r.Self()); }
+        template<class E> inline VectorScale<E> operator*(const double& k, const VectorExpression<E>& e) { return VectorScale<E>(e.Self(), k); }
+        template<class E> inline VectorScale<E> operator*(const VectorExpression<E>& e, const double& k) { return VectorScale<E>(e.Self(), k); }
+        template<class E> inline MatrixVectorProduct<E> operator*(const MatrixRef& m, const VectorExpression<E>& v) { return MatrixVectorProduct<E>(m.Data(), v.Self()); }
+        template<class E> inline TransposedVectorProduct<E> operator*(const TransposedRef& m, const VectorExpression<E>& v) { return TransposedVectorProduct<E>(m.Data(), v.Self()); }
+
+        template<class L, class R> inline MatrixBinary<L, R, Plus> operator+(const MatrixExpression<L>& l, const MatrixExpression<R>& r) { return MatrixBinary<L, R, Plus>(l.Self(), r.Self()); }
+        template<class L, class R> inline MatrixBinary<L, R, Minus> operator-(const MatrixExpression<L>& l, const MatrixExpression<R>& r) { return MatrixBinary<L, R, Minus>(l.Self(), r.Self()); }
+        template<class E> inline MatrixScale<E> operator*(const double& k, const MatrixExpression<E>& e) { return MatrixScale<E>(e.Self(), k); }
+        template<class E> inline MatrixScale<E> operator*(const MatrixExpression<E>& e, const double& k) { return MatrixScale<E>(e.Self(), k); }
+
+        /// @brief Elementwise (Hadamard) product of vectors
+        template<class L, class R> inline VectorBinary<L, R, Times> Hadamard(const VectorExpression<L>& l, const VectorExpression<R>& r) { return VectorBinary<L, R, Times>(l.Self(), r.Self()); }
+
+        /// @brief Elementwise (Hadamard) product of matrices
+        template<class L, class R> inline MatrixBinary<L, R, Times> Hadamard(const MatrixExpression<L>& l, const MatrixExpression<R>& r) { return MatrixBinary<L, R, Times>(l.Self(), r.Self()); }
+
+        /// @brief Outer product a*b_T
+        template<class L, class R> inline OuterProduct<L, R> Outer(const VectorExpression<L>& a, const VectorExpression<R>& b) { return OuterProduct<L, R>(a.Self(), b.Self()); }
+
+        /// @brief Apply f to each element
+        template<class F, class E> inline VectorMap<F, E> Map(F f, const VectorExpression<E>& e) { return VectorMap<F, E>(f, e.Self()); }
+
+        /*
+            Evaluation
+        */
+
+        /// @brief Evaluate elements from..to-1 of the expression into dst
+        template<class E> inline void AssignRange(double* dst, const VectorExpression<E>& e, const size_t& from, const size_t& to) {
+            const E& x = e.Self();
+            for (size_t i = from; i < to; i++) dst[i] = x[i];
+        }
+
+        /// @brief Evaluate the expression into dst (resized if needed), in a single loop
+        template<class E> inline void Assign(vector<double>& dst, const VectorExpression<E>& e) {
+            const size_t n = e.Size();
+            if (dst.size() != n) dst.resize(n);
+            AssignRange(dst.data(), e, 0, n);
+        }
+
+        /// @brief Evaluate the expression into dst (resized if needed), elements partitioned on pool workers. Result is the same of Assign().
+        template<class E> inline void AssignParallel(vector<double>& dst, const VectorExpression<E>& e, TaskPool& pool) {
+            const size_t n = e.Size();
+            if (dst.size() != n) dst.resize(n);
+            double* data = dst.data();
+            pool.ParallelFor(0, n, 0, [data, &e](size_t from, size_t to) { AssignRange(data, e, from, to); });
+        }
+
+        /// @brief Evaluate the expression into dst (must have the same size), in a single loop nest
+        template<class E> inline void Assign(Matrix& dst, const MatrixExpression<E>& e) {
+            if (dst.Rows() != e.Rows() || dst.Cols() != e.Cols()) throw out_of_range("Expression: destination matrix size mismatch.");
+            const E& x = e.Self();
+            const size_t rows = dst.Rows();
+            const size_t cols = dst.Cols();
+            for (size_t i = 0; i < rows; i++) {
+                double* row = dst[i];
+                for (size_t j = 0; j < cols; j++) row[j] = x(i, j);
+            }
+        }
+    }
+}
+
+#endif
@@ -22,13 +22,25 @@
 
 #include "BriandInclude.hxx"
 #include "BriandMatrix.hxx"
+#include "BriandExpression.hxx"
+#include "BriandInferenceModel.hxx"
+#include "BriandQuantization.hxx"
 #include "BriandMath.hxx"
+#include "BriandTrace.hxx"
 
 using namespace std;
 using namespace Briand;
 
 namespace Briand {
 
+    /** @brief How hidden neurons are scored for structured pruning (lower score = removed first) */
+    enum class NeuronScore { 
+        /// @brief Norm of incoming weights multiplied by norm of outgoing weights
+        WeightNorm, 
+        /// @brief Mean absolute activation over a dataset multiplied by norm of outgoing weights
+        Activation 
+    };
+
     /** @brief A layer of neurons */
     class NeuralLayer {
         protected:
@@ -36,13 +48,24 @@ namespace Briand {
         /// @brief Weights FROM PREVIOUS LAYER
         unique_ptr<Matrix> _weights;
 
+        /// @brief Pruned weights in sparse format (nullptr if layer has not been pruned). The dense _weights are kept for training.
+        unique_ptr<SparseMatrix> _sparseWeights;
+
+        /// @brief True if sparse weights are used for propagation (sparse kernel is faster than the dense one)
+        bool _useSparse;
+
+        /// @brief Weights in 16 bit storage (nullptr if double). When set they are used for propagation (before sparse ones)
+        /// and _weights is the master copy for training, or nullptr if it has been dropped (inference only).
+        unique_ptr<HalfMatrix> _halfWeights;
+
         /// @brief Neuron net values (weighted sum)
         unique_ptr<vector<double>> _neuronsNet;
 
         /// @brief Neuron activated values 
         unique_ptr<vector<double>> _neuronsOut;
         
-        /// @brief Bias neuron weights (input and hidden layers only, otherwise nullptr)
+        /// @brief Bias neuron weights (input and hidden layers, otherwise nullptr). When the network is closed the input layer bias
+        /// is folded into the first layer's bias (so it may be the output layer) and set to nullptr.
         unique_ptr<vector<double>> _bias_weights;
 
         /// @brief Delta of this layer
@@ -57,12 +80,34 @@ namespace Briand {
         /// @brief Layer activation function derivative (hidden and output layer only)
         ActivationFunction _df;
 
+        /// @brief Layer activation function derivative taking the activated value (nullptr if _df is not a known one, then _df is used on net values)
+        ActivationFunction _dfOut;
+
         /// @brief Error calculation function
         ErrorFunction _E;
 
         /// @brief Error calculation function derivative
         ErrorFunction _dE;
 
+        /// @brief Softmax output layer (activation Math::Softmax): net values are computed as is and normalized over the layer
+        bool _softmax;
+
+        /// @brief Element-wise activation used by the kernels (identity for softmax layers, normalized afterwards)
+        inline ActivationFunction Elementwise() const { return this->_softmax ? Math::Identity : this->_f; }
+
+        /// @brief Quantization aware training: fake quantized weights used for propagation (nullptr if not enabled)
+        unique_ptr<Matrix> _fakeWeights;
+
+        /// @brief Quantization aware training: net values range (hidden and output layers)
+        QuantizationObserver _netObserver;
+
+        /// @brief Quantization aware training: output values range (input values for the input layer)
+        QuantizationObserver _outObserver;
+
+        /// @brief Finish the activation of output values (softmax normalization, nothing otherwise)
+        /// @param out Output values (one for each neuron)
+        inline void Normalize(double* out) const { if (this->_softmax) Math::SoftmaxInPlace(out, this->_neuronsOut->size()); }
+
         public:
 
         /// @brief Builds a layer.
@@ -120,6 +165,61 @@ namespace Briand {
         /// @brief true when output layer is set
         bool _hasOutputs;
 
+        /// @brief Incremental first layer update enabled
+        bool _incremental;
+
+        /// @brief Incremental mode: maximum fraction of changed inputs for a column update (otherwise full recompute)
+        double _incrementalThreshold;
+
+        /// @brief Incremental mode: full recompute every this number of propagations (bounds floating point drift)
+        size_t _incrementalResync;
+
+        /// @brief Incremental mode: propagations since the latest full recompute
+        size_t _incrementalCount;
+
+        /// @brief Incremental mode: first layer net values are consistent with _previousInput and current weights
+        bool _incrementalValid;
+
+        /// @brief Incremental mode: input of the latest propagation
+        unique_ptr<vector<double>> _previousInput;
+
+        /// @brief Incremental mode: propagate the first layer applying only the changed inputs (z += W[:,j] * dx_j)
+        /// @return true if done, false if a full recompute is needed
+        bool PropagateFirstLayerIncremental();
+
+        /// @brief Training: W_T * delta of the layer being backpropagated (kept between Train() calls to avoid allocations)
+        unique_ptr<vector<double>> _backpropagated;
+
+        /// @brief Seed for weights initialization (layer k uses stream seed + k)
+        uint64_t _seed;
+
+        /// @brief Quantization aware training enabled
+        bool _quantizationAware;
+
+        /// @brief Quantization aware training: observers EMA momentum
+        double _quantizationMomentum;
+
+        /// @brief Quantization aware training: observers are updated by the next propagation (training and calibration only)
+        bool _quantizationObserve;
+
+        /// @brief Quantization aware propagation: fake quantized inputs, weights (symmetric, per row), net and output values
+        void PropagateQuantizationAware();
+
+        /// @brief Throw if some layer has 16 bit weights without the master copy
+        /// @param operation Operation name for the error message
+        void RequireMasterWeights(const char* operation) const;
+
+        /// @brief Fold the input layer bias into the first layer's bias: b_1 = b_1 + W_1 * b_in (the input is then used as is)
+        void FoldInputBias();
+
+        /// @brief Initial weights for a new layer
+        /// @param rows Layer neurons
+        /// @param cols Previous layer neurons
+        /// @param activationFunc Layer activation function (used with WeightInit::Auto)
+        /// @param init Initialization method
+        /// @return Weights matrix
+        unique_ptr<Matrix> InitialWeights(const size_t& rows, const size_t& cols, const ActivationFunction& activationFunc, const WeightInit& init);
+
         public:
         
         /// @brief Build empty FCNN
@@ -127,6 +227,11 @@ namespace Briand {
 
         ~FCNN();
 
+        /// @brief Set the seed for weights initialization of the layers added from now (default is Random::GlobalSeed()).
+        /// Same seed and same structure give the same weights.
+        /// @param seed Seed
+        void SetSeed(const uint64_t& seed);
+
         /// @brief Adds input layer (can be called only once). STARTS THE NETWORK CREATION (must be first layer)
         /// @param inputs Number of inputs
         void AddInputLayer(const size_t& inputs);
@@ -139,12 +244,18 @@ namespace Briand {
         /// @brief Set input for FCNN
         /// @param values Input values
         void SetInput(const vector<double>& values);
+
+        /// @brief Set input for FCNN from a buffer (for example a SlidingWindow view, no copy in a vector)
+        /// @param values Input values
+        /// @param size Number of values (must be equal to input neurons)
+        void SetInput(const double* values, const size_t& size);
  
         /// @brief Adds hidden layer, in sequence. CONTINUES NETWORK CREATION (must be a "middle" layer)
         /// @param outputs Number of neurons
         /// @param activationFunc Activation function
         /// @param activationDer Activation function derivative
-        void AddHiddenLayer(const size_t& neurons, const ActivationFunction& activationFunc, const ActivationFunction& activationDer);
+        /// @param init Weights initialization (default: He for ReLU, Xavier otherwise)
+        void AddHiddenLayer(const size_t& neurons, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const WeightInit& init = WeightInit::Auto);
 
         /// @brief Adds hidden layer, in sequence. CONTINUES NETWORK CREATION (must be a "middle" layer)
         /// @param outputs Number of outputs
@@ -153,13 +264,16 @@ namespace Briand {
         /// @param weights Weights from previous layer (must have 1 row for each layer's neuron, 1 column for each previous layer neuron)
         void AddHiddenLayer(const size_t& neurons, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const Matrix& weights);
 
-        /// @brief Adds output layer (can be called only once). CLOSES THE NETWORK CREATION (must be latest layer)
+        /// @brief Adds output layer (can be called only once). CLOSES THE NETWORK CREATION (must be latest layer).
+        /// For classification use Math::Softmax, Math::DeSoftmax, Math::CrossEntropy, Math::DeCrossEntropy: softmax is computed
+        /// over the whole layer (numerically stable) and the output delta is simply y - t.
         /// @param outputs Number of outputs
         /// @param activationFunc Activation function
         /// @param activationDer Activation function derivative
         /// @param errorFunc Error/cost function
         /// @param errorFuncDer Error/cost function derivative
-        void AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer);
+        /// @param init Weights initialization (default: He for ReLU, Xavier otherwise)
+        void AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer, const WeightInit& init = WeightInit::Auto);
         
         /// @brief Adds output layer (can be called only once) with weights. CLOSES THE NETWORK CREATION (must be latest layer)
         /// @param outputs Number of outputs
@@ -170,6 +284,16 @@ namespace Briand {
         /// @param weights Weights from previous layer (must have 1 row for each layer's neuron, 1 column for each previous layer neuron)
         void AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer, const Matrix& weights);
     
+        /// @brief Enable incremental inference, for inputs changing a few at a time (streaming sensors). The first layer keeps 
+        /// the previous input and net values and applies only the changed inputs as column updates.
+        /// Training or pruning the network forces a full recompute on the next propagation.
+        /// @param threshold Maximum fraction of changed inputs (0.0 to 1.0) for an incremental update, above it the first layer is recomputed
+        /// @param resyncInterval Full recompute every this number of propagations, to bound floating point drift (0 = never)
+        void EnableIncremental(const double& threshold = 0.25, const size_t& resyncInterval = 1000);
+
+        /// @brief Disable incremental inference (frees the previous input copy)
+        void DisableIncremental();
+
         /// @brief Propagates (forward).
         void Propagate();
 
@@ -178,6 +302,36 @@ namespace Briand {
         /// @return Output neurons values (result)
         unique_ptr<vector<double>> Predict(const vector<double>& inputs);
 
+        /// @brief Create a context for Predict() with context (one for each thread calling it concurrently)
+        /// @return Context sized to the widest layer
+        unique_ptr<ExecutionContext> CreateContext() const;
+
+        /// @brief Propagates the input forward without writing the network: neuron values stay untouched and scratch values are kept
+        /// in the context. Many threads can call it at the same time on the same network, each one with its own context
+        /// (but not while the network is trained or modified).
+        /// @param inputs Input values
+        /// @param context Context of the calling thread
+        /// @return Output neurons values (result)
+        unique_ptr<vector<double>> Predict(const vector<double>& inputs, ExecutionContext& context) const;
+
+        /// @brief As Predict() with context, reading the inputs from a buffer (for example a SlidingWindow view, no copy in a vector)
+        /// @param inputs Input values
+        /// @param size Number of input values (must be equal to input neurons)
+        /// @param context Context of the calling thread
+        /// @return Output neurons values (result)
+        unique_ptr<vector<double>> Predict(const double* inputs, const size_t& size, ExecutionContext& context) const;
+
+        /// @brief As Predict() with context, reading the inputs from a buffer and writing the outputs in a buffer (no allocations)
+        /// @param inputs Input values
+        /// @param size Number of input values (must be equal to input neurons)
+        /// @param outputs Output values (must have room for Outputs() values)
+        /// @param context Context of the calling thread
+        void Predict(const double* inputs, const size_t& size, double* outputs, ExecutionContext& context) const;
+
+        /// @brief Number of output neurons
+        /// @return Output neurons (0 if the output layer is missing)
+        size_t Outputs() const;
+
         /// @brief Returns output neurons values after a Propagate()
         /// @return Output neurons values (result)
         unique_ptr<vector<double>> GetResult();
@@ -189,8 +343,100 @@ namespace Briand {
         /// @return Total error (sum of errors)
         double Train(const vector<double>& inputs, const vector<double>& targets, const double& learningRate);
 
+        /// @brief Total error of outputs against targets, with the output layer error function
+        /// @param outputs Output values
+        /// @param targets Target values
+        /// @return Total error (sum of errors)
+        double Loss(const vector<double>& outputs, const vector<double>& targets) const;
+
+        /// @brief Restore weights and bias from a frozen model of the same network (for example a checkpoint made with Freeze())
+        /// @param model Frozen model (same layers and sizes)
+        void Restore(const InferenceModel& model);
+
         /// @brief Print out result
         void PrintResult();
+
+        /// @brief Magnitude pruning of all layers weights. Smallest weights are set to zero (they will stay zero while training)
+        /// and, if faster, sparse weights are used for propagation.
+        /// @param sparsity Fraction of each layer's weights to be pruned (0.0 to 1.0)
+        void Prune(const double& sparsity);
+
+        /// @brief Score hidden layer neurons for structured pruning (lower score = less important).
+        /// @param layer Hidden layer index (1 is the first hidden layer)
+        /// @param score Scoring method
+        /// @param samples Input samples (required for NeuronScore::Activation only)
+        /// @return One score for each layer's neuron
+        unique_ptr<vector<double>> ScoreNeurons(const size_t& layer, const NeuronScore& score, const vector<vector<double>>& samples = {});
+
+        /// @brief Remove neurons from a hidden layer: weight rows and bias of this layer, weight columns of next layer. 
+        /// The network remains a dense (smaller) network.
+        /// @param layer Hidden layer index (1 is the first hidden layer)
+        /// @param neurons Indexes of neurons to remove (at least one neuron must remain)
+        void RemoveNeurons(const size_t& layer, const vector<size_t>& neurons);
+
+        /// @brief Structured pruning: remove the lowest scored fraction of neurons from each hidden layer (at least one neuron is kept).
+        /// @param fraction Fraction of neurons to remove in each hidden layer (0.0 to 1.0)
+        /// @param score Scoring method
+        /// @param samples Input samples (required for NeuronScore::Activation only)
+        void PruneNeurons(const double& fraction, const NeuronScore& score, const vector<vector<double>>& samples = {});
+
+        /// @brief Iterative structured pruning: the fraction of neurons is removed in steps, each step followed by fine-tuning epochs.
+        /// @param fraction Total fraction of neurons to remove in each hidden layer (0.0 to 1.0)
+        /// @param steps Number of prune and fine-tune steps
+        /// @param score Scoring method
+        /// @param inputs Training inputs (used also as samples for scoring)
+        /// @param targets Training targets
+        /// @param epochs Fine-tuning epochs after each step
+        /// @param learningRate Learning rate
+        /// @return Mean error of the latest fine-tuning epoch
+        double PruneAndFinetune(const double& fraction, const uint8_t& steps, const NeuronScore& score, const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const size_t& epochs, const double& learningRate);
+
+        /// @brief Set the weights storage of all layers. With 16 bit storage propagation reads half the memory of a float (a quarter 
+        /// of a double) and accumulates in double; the double weights can be kept as master copy for training (updated weights 
+        /// are converted again after each step) or dropped to save memory (the network can then only propagate and be frozen).
+        /// @param storage WeightStorage::Double, WeightStorage::Half or WeightStorage::BFloat16
+        /// @param keepMaster Keep the double weights for training (16 bit storage only)
+        void SetWeightStorage(const WeightStorage& storage, const bool& keepMaster = true);
+
+        /// @brief Enable quantization aware training (QAT): propagation fake-quantizes inputs, weights, net and output values to int8
+        /// as the integer model does, training updates the double weights with straight-through gradients (quantization is 
+        /// ignored by the backward pass) and observers track the ranges of values while training. Export with Quantize().
+        /// Propagation uses dense double weights (not sparse, 16 bit or incremental); Predict() with context is not affected.
+        /// @param momentum Observers EMA momentum (0.0 to 1.0)
+        void EnableQuantizationAware(const double& momentum = 0.99);
+
+        /// @brief Disable quantization aware training (ranges are forgotten)
+        void DisableQuantizationAware();
+
+        /// @brief Observe the ranges of values over samples without training (post-training quantization). 
+        /// Enables quantization aware propagation if not enabled.
+        /// @param samples Input samples
+        void Calibrate(const vector<vector<double>>& samples);
+
+        /// @brief Export the int8 model, with the ranges observed by quantization aware training or Calibrate()
+        /// @return Quantized model
+        unique_ptr<QuantizedModel> Quantize();
+
+        /// @brief Weights shape of each layer after the input
+        /// @return (rows, cols) for each layer
+        vector<pair<size_t, size_t>> LayerShapes();
+
+        /// @brief Number of weights and bias (parameters)
+        /// @return Parameters
+        size_t Parameters();
+
+        /// @brief Memory used by weights (dense and sparse) and bias
+        /// @return Bytes
+        size_t WeightsMemoryUsage();
+
+        /// @brief Memory used by the trainable network: weights, bias, neuron values, deltas and objects
+        /// @return Bytes
+        size_t MemoryUsage();
+
+        /// @brief Export an inference-only copy of the network (weights in a single read-only blob, no training state).
+        /// Pruned layers are exported dense (pruned weights are zero), 16 bit layers with their 16 bit weights (the ones Predict() runs, kept in 16 bit).
+        /// @return Frozen model
+        unique_ptr<InferenceModel> Freeze();
     };
 }
 
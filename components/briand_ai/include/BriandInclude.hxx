@@ -18,7 +18,19 @@
 #pragma once
 
 #ifndef BRIAND_AI_DEBUG
-    #define BRIAND_AI_DEBUG 1 // DEBUG MODE (print to stdout calculus and other info)
+    #define BRIAND_AI_DEBUG 0 // DEBUG MODE (log calculus and other info, sets BRIAND_AI_LOG_LEVEL to debug)
+#endif
+
+#ifndef BRIAND_AI_LOG_LEVEL
+    #if BRIAND_AI_DEBUG
+        #define BRIAND_AI_LOG_LEVEL 4 
+    #else
+        #define BRIAND_AI_LOG_LEVEL 3 // Library log statements above this level are not compiled (0 none, 1 error, 2 warn, 3 info, 4 debug, 5 verbose)
+    #endif
+#endif
+
+#ifndef BRIAND_AI_PARALLEL_THRESHOLD
+    #define BRIAND_AI_PARALLEL_THRESHOLD 16384 // Minimum matrix elements (rows*cols) for multi-core kernels, smaller ones stay single-threaded
 #endif
 
 #ifndef BRIAND_INCLUDE_H
@@ -34,6 +46,7 @@
     #include <memory>
     #include <vector>
     #include <map>
+    #include <unordered_map>
     #include <cstdlib>
     #include <cstring>
     #include <thread>
@@ -43,6 +56,11 @@
     #include <signal.h>
 	#include <limits>
 	#include <cassert>
+	#include <functional>
+	#include <atomic>
+	#include <mutex>
+	#include <condition_variable>
+	#include <deque>
 
     /* 
         Small code redefining in linux/windows platform used ESP functions and types in order to compile and test on other platforms
@@ -57,6 +75,11 @@
         #include "esp_log.h"
 		#include "esp_random.h"
 		#include "esp_timer.h"
+		#include "esp_pthread.h"
+		#include "nvs.h"
+		#include "nvs_flash.h"
+		#include "freertos/FreeRTOS.h"
+		#include "freertos/task.h"
 
     #elif defined(__linux__) | defined(_WIN32)
         // Set BRIAND_PLATFORM for printing out current platform if needed
@@ -154,6 +177,7 @@
 		#define ESP_ERR_NOT_FOUND -2
 		#define ESP_ERR_NVS_NO_FREE_PAGES -3
 		#define ESP_ERR_NVS_NEW_VERSION_FOUND -4
+		#define ESP_ERR_INVALID_ARG 0x102
 
 		typedef int esp_err_t;
 
@@ -173,11 +197,18 @@
 		extern unique_ptr<map<string, esp_log_level_t>> LOG_LEVELS_MAP;
 		void esp_log_level_set(const char* tag, esp_log_level_t level);
 		esp_log_level_t esp_log_level_get(const char* tag);
-		#define ESP_LOGI(tag, _format, ...) { if(esp_log_level_get(tag) >= ESP_LOG_INFO) { printf("I "); printf(tag); printf(" "); printf(_format, ##__VA_ARGS__); } }
-		#define ESP_LOGV(tag, _format, ...) { if(esp_log_level_get(tag) >= ESP_LOG_VERBOSE) { printf("V "); printf(tag); printf(" "); printf(_format, ##__VA_ARGS__); } }
-		#define ESP_LOGD(tag, _format, ...) { if(esp_log_level_get(tag) >= ESP_LOG_DEBUG) { printf("D "); printf(tag); printf(" "); printf(_format, ##__VA_ARGS__); } }
-		#define ESP_LOGE(tag, _format, ...) { if(esp_log_level_get(tag) >= ESP_LOG_ERROR) { printf("E "); printf(tag); printf(" "); printf(_format, ##__VA_ARGS__); } }
-		#define ESP_LOGW(tag, _format, ...) { if(esp_log_level_get(tag) >= ESP_LOG_WARN) { printf("W "); printf(tag); printf(" "); printf(_format, ##__VA_ARGS__); } }
+
+		/** Level of a tag, the pointer is valid until program ends. ESP_LOGx macros look up once for each call site 
+		 * (tag must be the same for a call site, like a static TAG), then filtering is one integer compare.
+		 */
+		const esp_log_level_t* esp_log_level_handle(const char* tag);
+
+		#define ESP_LOG_LINUX(letter, level, tag, _format, ...) { static const esp_log_level_t* _h = esp_log_level_handle(tag); if(*_h >= level) { printf(letter " %s ", tag); printf(_format, ##__VA_ARGS__); } }
+		#define ESP_LOGI(tag, _format, ...) ESP_LOG_LINUX("I", ESP_LOG_INFO, tag, _format, ##__VA_ARGS__)
+		#define ESP_LOGV(tag, _format, ...) ESP_LOG_LINUX("V", ESP_LOG_VERBOSE, tag, _format, ##__VA_ARGS__)
+		#define ESP_LOGD(tag, _format, ...) ESP_LOG_LINUX("D", ESP_LOG_DEBUG, tag, _format, ##__VA_ARGS__)
+		#define ESP_LOGE(tag, _format, ...) ESP_LOG_LINUX("E", ESP_LOG_ERROR, tag, _format, ##__VA_ARGS__)
+		#define ESP_LOGW(tag, _format, ...) ESP_LOG_LINUX("W", ESP_LOG_WARN, tag, _format, ##__VA_ARGS__)
 
 		void ESP_ERROR_CHECK(esp_err_t e);
 
@@ -260,6 +291,8 @@
 		};
 
 		#define portTICK_PERIOD_MS 1
+		#define portNUM_PROCESSORS 2
+		#define tskNO_AFFINITY 0x7FFFFFFF
 
 		typedef uint64_t TickType_t;
 		typedef int BaseType_t;
@@ -314,6 +347,16 @@
 				UBaseType_t uxPriority,
 				TaskHandle_t * const pvCreatedTask);
 
+		/** On Linux xCoreID is the CPU the thread is pinned to (modulo available CPUs), tskNO_AFFINITY for no pinning. uxPriority is ignored. */
+		BaseType_t xTaskCreatePinnedToCore(
+				TaskFunction_t pvTaskCode,
+				const char * const pcName,
+				const uint32_t usStackDepth,
+				void * const pvParameters,
+				UBaseType_t uxPriority,
+				TaskHandle_t * const pvCreatedTask,
+				const BaseType_t xCoreID);
+
 		void vTaskDelete(TaskHandle_t handle);
 
 		UBaseType_t uxTaskGetNumberOfTasks();
@@ -335,6 +378,9 @@
 		esp_err_t esp_pthread_set_cfg(const esp_pthread_cfg_t *cfg);
 		esp_err_t esp_pthread_get_cfg(esp_pthread_cfg_t *p);
 		esp_err_t esp_pthread_init(void);
+
+		/** Linux only: pin the calling thread to the core given in esp_pthread_cfg_t.pin_to_core (as ESP does at pthread creation), tskNO_AFFINITY for no pinning */
+		esp_err_t briand_pthread_apply_cfg(const esp_pthread_cfg_t *cfg);
 		
 
 		// MISC
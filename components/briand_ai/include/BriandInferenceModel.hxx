@@ -0,0 +1,188 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_INFERENCE_MODEL_H
+#define BRIAND_INFERENCE_MODEL_H
+
+#include "BriandInclude.hxx"
+#include "BriandMath.hxx"
+#include "BriandMatrix.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief A dense layer of an InferenceModel (pointers into the model blob) */
+    class InferenceLayer {
+        public:
+        /// @brief Number of inputs (previous layer neurons)
+        size_t Inputs;
+        /// @brief Number of outputs (layer neurons)
+        size_t Outputs;
+        /// @brief Weights storage format
+        WeightStorage Storage;
+        /// @brief Weights, row major (Outputs rows, Inputs cols), nullptr if stored in 16 bit
+        const double* Weights;
+        /// @brief 16 bit weights (Half or BFloat16), row major (Outputs rows, Inputs cols), nullptr if stored as double
+        const uint16_t* HalfWeights;
+        /// @brief Bias (Outputs values), nullptr if none
+        const double* Bias;
+        /// @brief Activation function
+        ActivationFunction F;
+        /// @brief True if F is Math::Softmax (layer normalized after the element-wise pass)
+        bool Softmax;
+    };
+
+    /** @brief Scratch buffers for one forward pass at a time: two ping-pong activation buffers.
+        Models are never written by Predict() with a context, so many threads (or FreeRTOS tasks) can share one model, 
+        each one with its own context.
+    */
+    class ExecutionContext {
+        protected:
+
+        /// @brief Ping-pong activation buffers
+        unique_ptr<double[]> _buffers[2];
+
+        /// @brief Buffers size
+        size_t _width;
+
+        public:
+
+        /// @brief Build a context
+        /// @param width Buffers size (widest layer of the model)
+        ExecutionContext(const size_t& width);
+
+        /// @brief Buffers size
+        size_t Width() const;
+
+        /// @brief Grow buffers if smaller than width (content is lost)
+        /// @param width Buffers size
+        void Reserve(const size_t& width);
+
+        /// @brief Activation buffer
+        /// @param index 0 or 1
+        /// @return Buffer
+        inline double* Buffer(const size_t& index) { return this->_buffers[index & 1].get(); }
+
+        /// @brief Memory used by buffers and object
+        /// @return Bytes
+        size_t MemoryUsage() const;
+    };
+
+    /** @brief Inference-only (frozen) FCNN: read-only weights in a single contiguous blob and two ping-pong 
+        activation buffers sized to the widest layer. No training state (net values, deltas, derivatives, error functions).
+        Build it with FCNN::Freeze() or over an existing blob (for example a const array, kept in flash on ESP32).
+        Predict() with an ExecutionContext is const and thread safe; Predict() without uses the model own context (one caller at a time).
+
+        Blob layout (doubles): number of layers L (input included), L layer sizes, then for each layer after the input:
+        flags (bias flag 0 or 1, plus 2 for Half or 4 for BFloat16 weights), weights (row major), bias values (if bias flag is 1).
+        16 bit weights are packed four in each double (the last one padded with zeros): a frozen 16 bit network keeps a quarter of the memory.
+    */
+    class InferenceModel {
+        protected:
+
+        /// @brief Blob owned by the model (nullptr if the blob is external)
+        unique_ptr<double[]> _ownedBlob;
+
+        /// @brief Blob
+        const double* _blob;
+
+        /// @brief Blob size (doubles)
+        size_t _blobSize;
+
+        /// @brief Layers (input excluded)
+        vector<InferenceLayer> _layers;
+
+        /// @brief Widest layer size (input included)
+        size_t _widest;
+
+        /// @brief Context used by Predict() without a context
+        unique_ptr<ExecutionContext> _context;
+
+        /// @brief Parse the blob and build layers
+        /// @param activations Activation function of each layer after the input
+        void Build(const vector<ActivationFunction>& activations);
+
+        public:
+
+        /// @brief Build a model owning the blob
+        /// @param blob Blob
+        /// @param size Blob size (doubles)
+        /// @param activations Activation function of each layer after the input
+        InferenceModel(unique_ptr<double[]> blob, const size_t& size, const vector<ActivationFunction>& activations);
+
+        /// @brief Build a model over an external blob, not copied (must live as long as the model, may be in flash)
+        /// @param blob Blob
+        /// @param size Blob size (doubles)
+        /// @param activations Activation function of each layer after the input
+        InferenceModel(const double* blob, const size_t& size, const vector<ActivationFunction>& activations);
+
+        ~InferenceModel();
+
+        /// @brief Number of inputs
+        size_t Inputs() const;
+
+        /// @brief Number of outputs
+        size_t Outputs() const;
+
+        /// @brief Layers (input excluded)
+        const vector<InferenceLayer>& Layers() const;
+
+        /// @brief Widest layer size (input included)
+        size_t WidestLayer() const;
+
+        /// @brief The blob (to export the model, for example as a const array to keep it in flash)
+        const double* Blob() const;
+
+        /// @brief Blob size (doubles)
+        size_t BlobSize() const;
+
+        /// @brief Create a context for this model (one for each thread calling Predict() concurrently)
+        /// @return Context
+        unique_ptr<ExecutionContext> CreateContext() const;
+
+        /// @brief Propagate forward using the model own context (not thread safe)
+        /// @param inputs Inputs (must be Inputs() values)
+        /// @param outputs Outputs (must have room for Outputs() values)
+        void Predict(const double* inputs, double* outputs);
+
+        /// @brief Propagate forward (thread safe, the model is only read)
+        /// @param inputs Inputs (must be Inputs() values)
+        /// @param outputs Outputs (must have room for Outputs() values)
+        /// @param context Context of the calling thread
+        void Predict(const double* inputs, double* outputs, ExecutionContext& context) const;
+
+        /// @brief Propagate forward using the model own context (not thread safe)
+        /// @param inputs Inputs
+        /// @return Output values
+        unique_ptr<vector<double>> Predict(const vector<double>& inputs);
+
+        /// @brief Propagate forward (thread safe, the model is only read)
+        /// @param inputs Inputs
+        /// @param context Context of the calling thread
+        /// @return Output values
+        unique_ptr<vector<double>> Predict(const vector<double>& inputs, ExecutionContext& context) const;
+
+        /// @brief RAM used by the model: object, layers, own context and the blob if owned (an external blob is not counted)
+        /// @return Bytes
+        size_t MemoryUsage() const;
+    };
+}
+
+#endif
@@ -0,0 +1,133 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_KERNEL_PROFILE_H
+#define BRIAND_KERNEL_PROFILE_H
+
+#include "BriandInclude.hxx"
+#include "BriandTaskPool.hxx"
+
+#ifndef BRIAND_AI_TRANSPOSE_TILE
+    #define BRIAND_AI_TRANSPOSE_TILE 32 // Default transpose tile size (source and destination tiles of doubles must fit L1 cache together, must be even)
+#endif
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Matrix-vector kernel */
+    enum class MatVecKernel : uint8_t { 
+        /// @brief Single core
+        Serial, 
+        /// @brief Rows partitioned on TaskPool::Default() workers
+        Parallel 
+    };
+
+    /** @brief Kernel choices used by Matrix for dispatch. Without a profile the defaults are used (parallel above 
+        BRIAND_AI_PARALLEL_THRESHOLD elements, BRIAND_AI_TRANSPOSE_TILE tiles). A profile is filled by KernelTuner and 
+        saved to a file (Linux) or to NVS (ESP32), so it is measured once for each machine.
+    */
+    class KernelProfile {
+        public:
+
+        /// @brief Matrix-vector kernel for each tuned shape (key is Key(rows, cols))
+        using MatVecMap = unordered_map<uint64_t, MatVecKernel>;
+
+        /// @brief Shape key (rows << 32 | cols)
+        static inline uint64_t Key(const size_t& rows, const size_t& cols) { return (static_cast<uint64_t>(rows) << 32) | static_cast<uint64_t>(cols); }
+
+        protected:
+
+        /// @brief Current profile: an immutable snapshot (nullptr if empty), lookups read it without locks
+        static atomic<const MatVecMap*> _matVec;
+
+        /// @brief Owner of the current snapshot
+        static unique_ptr<const MatVecMap> _current;
+
+        /// @brief Replaced snapshots: a lookup may still be reading one, they are freed by Reclaim()
+        static vector<unique_ptr<const MatVecMap>> _retired;
+
+        /// @brief Lock for writers (copy, modify and publish a new snapshot)
+        static mutex _lock;
+
+        /// @brief Publish a new snapshot, the current one is retired (call with _lock held)
+        /// @param matVec New profile (empty for none)
+        static void Publish(MatVecMap&& matVec);
+
+        /// @brief Transpose tile size
+        static atomic<size_t> _transposeTile;
+
+        public:
+
+        /// @brief True if a rows*cols matrix-vector product should run on multiple cores
+        /// @param rows Matrix rows
+        /// @param cols Matrix cols
+        static bool UseParallel(const size_t& rows, const size_t& cols);
+
+        /// @brief Tuned kernel for a shape
+        /// @param rows Matrix rows
+        /// @param cols Matrix cols
+        /// @param kernel Output kernel
+        /// @return true if the shape is in the profile
+        static bool Find(const size_t& rows, const size_t& cols, MatVecKernel& kernel);
+
+        /// @brief Set the kernel for a shape. Every call publishes a copy of the profile: to set many shapes use Merge().
+        static void Set(const size_t& rows, const size_t& cols, const MatVecKernel& kernel);
+
+        /// @brief Set the kernels of many shapes, publishing the profile once
+        /// @param kernels Kernel for each shape key
+        static void Merge(const MatVecMap& kernels);
+
+        /// @brief Free the replaced profile snapshots. Call only when no other task can be running a matrix kernel 
+        /// (KernelTuner::LoadOrTune() does it, as it runs before the network is used).
+        static void Reclaim();
+
+        /// @brief Transpose tile size
+        static size_t TransposeTile();
+
+        /// @brief Set the transpose tile size
+        /// @param tile Tile size (even, > 0)
+        static void SetTransposeTile(const size_t& tile);
+
+        /// @brief Back to defaults (empty profile). The replaced snapshot is freed by Reclaim().
+        static void Clear();
+
+        /// @brief Machine signature (architecture and number of workers): a profile is loaded only on the same signature
+        static string Signature();
+
+        /// @brief Profile as text
+        static string ToString();
+
+        /// @brief Load a profile from text (current profile is replaced, its snapshot is freed by Reclaim())
+        /// @return true if loaded, false if invalid or for another machine
+        static bool FromString(const string& text);
+
+        /// @brief Save the profile
+        /// @param name File path on Linux, NVS key (max 15 chars, namespace "briand_ai") on ESP32
+        /// @return true if saved
+        static bool Save(const char* name);
+
+        /// @brief Load a profile
+        /// @param name File path on Linux, NVS key (max 15 chars, namespace "briand_ai") on ESP32
+        /// @return true if loaded
+        static bool Load(const char* name);
+    };
+}
+
+#endif
@@ -0,0 +1,56 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_KERNEL_TUNER_H
+#define BRIAND_KERNEL_TUNER_H
+
+#include "BriandInclude.hxx"
+#include "BriandKernelProfile.hxx"
+#include "BriandMatrix.hxx"
+#include "BriandFCNN.hxx"
+#include "BriandLog.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Benchmarks the candidate Matrix kernels on this machine and records the fastest in KernelProfile */
+    class KernelTuner {
+        public:
+
+        /// @brief Tune the matrix-vector kernel (serial or parallel) for each shape
+        /// @param shapes Matrix shapes (rows, cols)
+        /// @param runs Runs for each candidate (the best time is used)
+        static void TuneMatVec(const vector<pair<size_t, size_t>>& shapes, const uint8_t& runs = 20);
+
+        /// @brief Tune the transpose tile size on a square matrix
+        /// @param size Matrix size
+        /// @param runs Runs for each candidate (the best time is used)
+        static void TuneTranspose(const size_t& size, const uint8_t& runs = 5);
+
+        /// @brief Load the profile; if missing, for another machine or not covering all the network shapes, tune and save it.
+        /// Call once at startup, before using the network.
+        /// @param fcnn Network
+        /// @param name File path on Linux, NVS key (max 15 chars) on ESP32
+        /// @return true if tuning has been done, false if the saved profile has been used
+        static bool LoadOrTune(FCNN& fcnn, const char* name);
+    };
+}
+
+#endif
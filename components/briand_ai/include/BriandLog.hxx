@@ -0,0 +1,156 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_LOG_H
+#define BRIAND_LOG_H
+
+#include "BriandInclude.hxx"
+
+#ifndef BRIAND_AI_LOG_QUEUE
+    #define BRIAND_AI_LOG_QUEUE 1024 // Maximum records waiting for the sink thread, further records are dropped
+#endif
+
+/* 
+    Library log macros. Statements above BRIAND_AI_LOG_LEVEL are not compiled at all.
+    Tag handle is looked up once for each call site (tag must be a constant), then runtime filtering is a single integer compare.
+    Records are written to output by a sink thread, the caller never waits for I/O.
+*/
+
+#define BRIAND_LOG_IMPL(level, tag, format, ...) do { static Briand::LogTag* _briand_log_tag = Briand::Log::GetTag(tag); if (_briand_log_tag->Level.load(std::memory_order_relaxed) >= level) Briand::Log::Write(level, _briand_log_tag, format, ##__VA_ARGS__); } while (0)
+#define BRIAND_LOG_VECTOR_IMPL(level, tag, name, v) do { static Briand::LogTag* _briand_log_tag = Briand::Log::GetTag(tag); if (_briand_log_tag->Level.load(std::memory_order_relaxed) >= level) Briand::Log::WriteValues(level, _briand_log_tag, name, v, 1, (v).size()); } while (0)
+#define BRIAND_LOG_MATRIX_IMPL(level, tag, name, m) do { static Briand::LogTag* _briand_log_tag = Briand::Log::GetTag(tag); if (_briand_log_tag->Level.load(std::memory_order_relaxed) >= level) (m).LogValues(level, _briand_log_tag, name); } while (0)
+#define BRIAND_LOG_NOTHING do { } while (0)
+
+#if BRIAND_AI_LOG_LEVEL >= 1
+    #define BRIAND_LOGE(tag, format, ...) BRIAND_LOG_IMPL(1, tag, format, ##__VA_ARGS__)
+#else
+    #define BRIAND_LOGE(tag, format, ...) BRIAND_LOG_NOTHING
+#endif
+
+#if BRIAND_AI_LOG_LEVEL >= 2
+    #define BRIAND_LOGW(tag, format, ...) BRIAND_LOG_IMPL(2, tag, format, ##__VA_ARGS__)
+#else
+    #define BRIAND_LOGW(tag, format, ...) BRIAND_LOG_NOTHING
+#endif
+
+#if BRIAND_AI_LOG_LEVEL >= 3
+    #define BRIAND_LOGI(tag, format, ...) BRIAND_LOG_IMPL(3, tag, format, ##__VA_ARGS__)
+#else
+    #define BRIAND_LOGI(tag, format, ...) BRIAND_LOG_NOTHING
+#endif
+
+#if BRIAND_AI_LOG_LEVEL >= 4
+    #define BRIAND_LOGD(tag, format, ...) BRIAND_LOG_IMPL(4, tag, format, ##__VA_ARGS__)
+    #define BRIAND_LOGD_VECTOR(tag, name, v) BRIAND_LOG_VECTOR_IMPL(4, tag, name, v)
+    #define BRIAND_LOGD_MATRIX(tag, name, m) BRIAND_LOG_MATRIX_IMPL(4, tag, name, m)
+#else
+    #define BRIAND_LOGD(tag, format, ...) BRIAND_LOG_NOTHING
+    #define BRIAND_LOGD_VECTOR(tag, name, v) BRIAND_LOG_NOTHING
+    #define BRIAND_LOGD_MATRIX(tag, name, m) BRIAND_LOG_NOTHING
+#endif
+
+#if BRIAND_AI_LOG_LEVEL >= 5
+    #define BRIAND_LOGV(tag, format, ...) BRIAND_LOG_IMPL(5, tag, format, ##__VA_ARGS__)
+#else
+    #define BRIAND_LOGV(tag, format, ...) BRIAND_LOG_NOTHING
+#endif
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief A log tag with its runtime level. Tags are never destroyed so handles can be cached. */
+    class LogTag {
+        public:
+        /// @brief Tag name
+        string Name;
+        /// @brief Records with level above this are discarded (0 none, 1 error, 2 warn, 3 info, 4 debug, 5 verbose)
+        atomic<int> Level;
+    };
+
+    /** @brief A log record waiting for the sink: a text message or a structured vector/matrix dump (formatted by the sink) */
+    class LogRecord {
+        public:
+        /// @brief Level
+        int Level;
+        /// @brief Tag
+        const LogTag* Tag;
+        /// @brief Time (esp_timer_get_time() microseconds)
+        uint64_t Time;
+        /// @brief Message or vector/matrix name
+        string Text;
+        /// @brief Values (row by row), empty for text messages
+        vector<double> Values;
+        /// @brief Value rows
+        size_t Rows;
+        /// @brief Value columns
+        size_t Cols;
+    };
+
+    /** @brief Library logging with an asynchronous, buffered sink thread */
+    class Log {
+        protected:
+
+        /// @brief Queue a record (dropped if the queue is full) and start the sink thread if needed
+        static void Push(LogRecord&& record);
+
+        /// @brief Sink thread loop
+        static void SinkLoop();
+
+        public:
+
+        /// @brief Get (or create) a tag handle. New tags have BRIAND_AI_LOG_LEVEL level (or the level set with "*").
+        /// @param name Tag name
+        /// @return Tag handle, valid until program ends
+        static LogTag* GetTag(const char* name);
+
+        /// @brief Set the runtime level of a tag
+        /// @param name Tag name, "*" for all tags (existing and new)
+        /// @param level Level (0 none, 1 error, 2 warn, 3 info, 4 debug, 5 verbose)
+        static void SetLevel(const char* name, const int& level);
+
+        /// @brief Queue a text message (printf format, newline is added)
+        /// @param level Level
+        /// @param tag Tag handle
+        /// @param format printf format (checked by the compiler)
+        static void Write(const int& level, const LogTag* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+        /// @brief Queue a structured values dump (values are copied, formatting is done by the sink)
+        /// @param level Level
+        /// @param tag Tag handle
+        /// @param name Name
+        /// @param values Values (row by row)
+        /// @param rows Rows
+        /// @param cols Columns
+        static void WriteValues(const int& level, const LogTag* tag, const char* name, const vector<double>& values, const size_t& rows, const size_t& cols);
+
+        /// @brief Set the sink output (default stdout)
+        /// @param out Output stream
+        static void SetOutput(FILE* out);
+
+        /// @brief Wait until all queued records are written
+        static void Flush();
+
+        /// @brief Number of records dropped because the queue was full
+        /// @return Dropped records
+        static size_t Dropped();
+    };
+}
+
+#endif
@@ -20,11 +20,18 @@
 #define BRIAND_MATH_H
 
 #include "BriandInclude.hxx"
+#include "BriandRandom.hxx"
 
 using namespace std;
 
 namespace Briand {
 
+    /// @brief Typedef (alias with C++ using) an activation function as a function returning a double and asking a const double& as parameter
+    using ActivationFunction =  double (*)(const double&);
+
+    /// @brief Typedef (alias with C++ using) an error calculation function as a function returning a double and asking two const double& as parameters (TARGET and OUTPUT)
+    using ErrorFunction =  double (*)(const double&, const double&);
+
     /** @brief class with math functions used in all the project. 
         If a more performing way of calculus is found then you need only to change the implementation here!
     */
@@ -47,12 +54,49 @@ namespace Briand {
         static constexpr double Sigmoid(const double& x) { return 1 / (1 + exp(-1 * x)); }
 
         /** @brief Sigmoid derivative */
-        static constexpr double DeSigmoid(const double& x) { return Sigmoid(x)*(1 - Sigmoid(x)); }
+        static constexpr double DeSigmoid(const double& x) { const double s = Sigmoid(x); return s * (1 - s); }
+
+        /** @brief Hyperbolic tangent function */
+        static constexpr double Tanh(const double& x) { return tanh(x); }
+
+        /** @brief Hyperbolic tangent derivative */
+        static constexpr double DeTanh(const double& x) { const double t = tanh(x); return 1 - t * t; }
+
+        /** @brief Identity derivative from the activated value a = f(x) */
+        static constexpr double DeIdentityFromOutput(const double&) { return 1; }
+
+        /** @brief ReLU derivative from the activated value a = f(x) */
+        static constexpr double DeReLUFromOutput(const double& a) { return a > 0 ? 1 : 0; }
+
+        /** @brief Sigmoid derivative from the activated value a = f(x): a(1 - a), no exp() */
+        static constexpr double DeSigmoidFromOutput(const double& a) { return a * (1 - a); }
+
+        /** @brief Hyperbolic tangent derivative from the activated value a = f(x): 1 - a^2, no tanh() */
+        static constexpr double DeTanhFromOutput(const double& a) { return 1 - a * a; }
+
+        /** @brief The derivative taking the activated value, for a derivative taking the net value (DeIdentity, DeReLU, DeSigmoid, DeTanh)
+            @param df Derivative taking the net value
+            @return Derivative taking the activated value, nullptr if unknown (df must be used with the net value)
+        */
+        static ActivationFunction DerivativeFromOutput(ActivationFunction df);
+
+        /** @brief Softmax element (unnormalized, exp(x)). As output layer activation the whole layer is normalized with SoftmaxInPlace()
+            and the layer must use CrossEntropy error */
+        static constexpr double Softmax(const double& x) { return exp(x); }
+
+        /** @brief Softmax derivative placeholder (always 1): with CrossEntropy the output delta is y - t, the Jacobian is never needed */
+        static constexpr double DeSoftmax(const double&) { return 1; }
+
+        /** @brief Numerically stable softmax in place: max subtraction in a first pass, exp and sum in a second one, then scaling
+            @param values Values (net values in, probabilities out)
+            @param n Number of values
+        */
+        static void SoftmaxInPlace(double* values, const size_t& n);
 
         /** @brief Weighted sum function */
         static double WeightedSum(const vector<double>& values, const vector<double>& weights);
 
-        /** @brief Random number between 0 and 1 */
+        /** @brief Random number in [0, 1) from the generator of the calling thread (see Random::Seed()) */
         static double Random();
 
         /** @brief Mean squared error */
@@ -60,13 +104,13 @@ namespace Briand {
         
         /** @brief Mean squared error derivative */
         static constexpr double DeMSE(const double& target, const double& output) { return (output - target); }
-    };
 
-    /// @brief Typedef (alias with C++ using) an activation function as a function returning a double and asking a const double& as parameter
-    using ActivationFunction =  double (*)(const double&);
+        /** @brief Cross-entropy error (output is a probability, clamped to avoid log(0)) */
+        static constexpr double CrossEntropy(const double& target, const double& output) { return target != 0 ? -target * log(output > 1e-300 ? output : 1e-300) : 0; }
 
-    /// @brief Typedef (alias with C++ using) an error calculation function as a function returning a double and asking two const double& as parameters (TARGET and OUTPUT)
-    using ErrorFunction =  double (*)(const double&, const double&);
+        /** @brief Cross-entropy error derivative with respect to the net value of a Softmax output (fused softmax + cross-entropy) */
+        static constexpr double DeCrossEntropy(const double& target, const double& output) { return (output - target); }
+    };
 
     /** @brief The NN layer type (input, hidden, output ...) */
     enum class LayerType { Input, Hidden, Output, Kernel, Pooling };
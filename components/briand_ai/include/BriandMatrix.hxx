@@ -21,6 +21,15 @@
 #define BRIAND_MATRIX_H
 
 #include "BriandInclude.hxx"
+#include "BriandMath.hxx"
+#include "BriandTaskPool.hxx"
+#include "BriandRandom.hxx"
+#include "BriandLog.hxx"
+#include "BriandKernelProfile.hxx"
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -45,6 +54,21 @@ namespace Briand {
         /// @param initialValue initial value of elements
         void InstanceMatrix(const double& initialValue = 0.0);
 
+        /// @brief Calculate rows [from, to) of this * v
+        void MultiplyVectorRows(const double* v, double* result, const size_t& from, const size_t& to) const;
+
+        /// @brief Fused dense layer kernel on rows from..to-1 (see MultiplyVectorActivate()), net may be nullptr
+        void MultiplyVectorActivateRows(const double* x, const double* bias, ActivationFunction f, double* net, double* out, const size_t& from, const size_t& to) const;
+
+        /// @brief Transpose the tile [rowFrom, rowTo) x [colFrom, colTo) into result, 2x2 blocks in registers
+        void TransposeTile(Matrix& result, const size_t& rowFrom, const size_t& rowTo, const size_t& colFrom, const size_t& colTo) const;
+
+        /// @brief Calculate rows [from, to) of this * other
+        void MultiplyMatrixRows(const Matrix& other, Matrix& result, const size_t& from, const size_t& to) const;
+
+        /* KernelTuner times the row kernels directly, without the profile dispatch */
+        friend class KernelTuner;
+
         public:
 
         /// @brief Build a new matrix RxC with initial value
@@ -70,23 +94,74 @@ namespace Briand {
         /// @return cols
         const size_t& Cols() const;
 
-        /// @brief Randomize all matrix values
+        /// @brief Randomize all matrix values (uniform between 0 and 1, generator of the calling thread)
         void Randomize();
 
+        /// @brief Fill with uniform values in [low, high). Each row has its own generator stream (seed, row), so the result 
+        /// depends only on the seed, also when rows are filled on multiple cores.
+        /// @param low Lower bound
+        /// @param high Upper bound (excluded)
+        /// @param seed Seed
+        void RandomizeUniform(const double& low, const double& high, const uint64_t& seed);
+
+        /// @brief Fill with normal values. Each row has its own generator stream (seed, row), so the result 
+        /// depends only on the seed, also when rows are filled on multiple cores.
+        /// @param mean Mean
+        /// @param stddev Standard deviation
+        /// @param seed Seed
+        void RandomizeNormal(const double& mean, const double& stddev, const uint64_t& seed);
+
+        /// @brief Fill with initial layer weights (FCNN, Conv1D and recurrent layers share this)
+        /// @param init Initialization method (Auto: He for ReLU, Xavier/Glorot otherwise)
+        /// @param activation Layer activation function (resolves Auto)
+        /// @param fanIn Inputs of each unit
+        /// @param fanOut Units
+        /// @param seed Seed
+        void RandomizeWeights(const WeightInit& init, const ActivationFunction& activation, const size_t& fanIn, const size_t& fanOut, const uint64_t& seed);
+
         /// @brief Multiply current matrix by a value.
         /// @param k value
         void MultiplyScalar(const double& k);
 
-        /// @brief Multiply current matrix by a vector
+        /// @brief Multiply current matrix by a vector. Runs on multiple cores as chosen by KernelProfile::UseParallel().
         /// @param v vector
         /// @return Pointer to resulting vector
         unique_ptr<vector<double>> MultiplyVector(const vector<double>& v);
 
+        /// @brief Multiply current matrix by a vector, output rows partitioned on pool workers. Result is the same of the single core version.
+        /// @param v vector
+        /// @param pool Task pool
+        /// @return Pointer to resulting vector
+        unique_ptr<vector<double>> MultiplyVectorParallel(const vector<double>& v, TaskPool& pool);
+
+        /// @brief Fused dense layer kernel: net = M*x + bias and out = f(net), computed in one pass over each row 
+        /// (no temporaries, no second loop). Runs on multiple cores as chosen by KernelProfile::UseParallel().
+        /// @param x Input vector (size must be equal to cols)
+        /// @param bias Bias vector (size must be equal to rows), nullptr if none
+        /// @param f Activation function
+        /// @param net Output net values (resized to rows if needed)
+        /// @param out Output activated values (resized to rows if needed)
+        void MultiplyVectorActivate(const vector<double>& x, const vector<double>* bias, const ActivationFunction& f, vector<double>& net, vector<double>& out) const;
+
+        /// @brief Fused dense layer kernel without net values: out = f(M*x + bias), single core (safe to call from many threads on the same matrix)
+        /// @param x Input values (cols)
+        /// @param bias Bias values (rows), nullptr if none
+        /// @param f Activation function
+        /// @param out Output activated values (rows)
+        void MultiplyVectorActivate(const double* x, const double* bias, const ActivationFunction& f, double* out) const;
+
         /// @brief Multiply current matrix with other (dot operation). If input matrix is m*n other matrix must be n*p. Result will be a m*p matrix.
+        /// Runs on multiple cores if m*n*p is at least BRIAND_AI_PARALLEL_THRESHOLD.
         /// @param other Matrix 
         /// @return new matrix
         unique_ptr<Matrix> MultiplyMatrix(const Matrix& other);
 
+        /// @brief Multiply current matrix with other (dot operation), output rows partitioned on pool workers. Result is the same of the single core version.
+        /// @param other Matrix 
+        /// @param pool Task pool
+        /// @return new matrix
+        unique_ptr<Matrix> MultiplyMatrixParallel(const Matrix& other, TaskPool& pool);
+
         /// @brief Multiply current matrix with other (Hadamard product). 
         /// If input matrix is m*n a(i,j) elements other matrix must be m*n b(i,j) elements. Result will be a m*n matrix where elements are a(i,j)*b(i,j).
         /// @param other Matrix 
@@ -104,9 +179,17 @@ namespace Briand {
         unique_ptr<Matrix> ApplyFunction(double (*f)(const double& x));
 
         /// @brief Transpose operation. If input matrix is m*n a(i,j) returns n*m matrix with a(j,i) elements.
+        /// Works by tiles (KernelProfile::TransposeTile()) so reads and writes stay in cache.
         /// @return Transposed Matrix
         unique_ptr<Matrix> Transpose();
 
+        /// @brief Transpose into an existing n*m matrix (no allocation)
+        /// @param result Transposed matrix
+        void Transpose(Matrix& result) const;
+
+        /// @brief Transpose a square matrix in place (no allocation), swapping tiles across the diagonal
+        void TransposeInPlace();
+
         /// @brief Opertor m[i] returns the internal matrix row
         /// @param idx row index
         /// @return reference to internal pointer
@@ -123,6 +206,314 @@ namespace Briand {
 
         /// @brief Print out a vector for debug
         static void PrintVector(const vector<double>& v);
+
+        /// @brief Queue a copy of the matrix to the log sink (use BRIAND_LOGD_MATRIX macro)
+        /// @param level Log level
+        /// @param tag Log tag
+        /// @param name Matrix name
+        void LogValues(const int& level, const LogTag* tag, const char* name) const;
+
+        /// @brief Copy of selected rows and columns (in the given order)
+        /// @param rows Row indexes to keep
+        /// @param cols Column indexes to keep
+        /// @return new matrix (rows.size() x cols.size())
+        unique_ptr<Matrix> Submatrix(const vector<size_t>& rows, const vector<size_t>& cols) const;
+
+        /// @brief Magnitude pruning: set to zero the given fraction of elements with the smallest absolute value.
+        /// @param sparsity Fraction of elements to be zeroed (0.0 to 1.0)
+        /// @return The magnitude threshold (elements with absolute value lower or equal are now zero)
+        double Prune(const double& sparsity);
+
+        /// @brief Fraction of elements equal to zero
+        /// @return Sparsity (0.0 to 1.0)
+        double Sparsity() const;
+
+        /// @brief Memory used by matrix elements and row pointers
+        /// @return Bytes
+        size_t MemoryUsage() const;
+    };
+
+    /** @brief Transposed view of a matrix: no copy, element (i,j) is element (j,i) of the matrix. 
+        The matrix must live as long as the view.
+    */
+    class TransposedView {
+        protected:
+
+        /// @brief Viewed matrix
+        const Matrix& _m;
+
+        public:
+
+        /// @brief Build a view
+        /// @param m Matrix
+        TransposedView(const Matrix& m);
+
+        /// @brief Rows (matrix columns)
+        const size_t& Rows() const;
+
+        /// @brief Columns (matrix rows)
+        const size_t& Cols() const;
+
+        /// @brief Element (i,j), that is matrix element (j,i)
+        inline const double& at(const size_t& i, const size_t& j) const { return this->_m[j][i]; }
+
+        /// @brief Multiply the view by a vector: M_T * v. Accumulates matrix rows scaled by v, so the matrix is read by rows.
+        /// @param v vector (size must be equal to matrix rows)
+        /// @return Pointer to resulting vector
+        unique_ptr<vector<double>> MultiplyVector(const vector<double>& v) const;
+
+        /// @brief Multiply the view by a vector: M_T * v
+        /// @param v Input values (matrix rows)
+        /// @param result Output values (matrix cols)
+        void MultiplyVector(const double* v, double* result) const;
+
+        /// @brief Copy into a new matrix
+        /// @return Transposed matrix
+        unique_ptr<Matrix> ToMatrix() const;
+    };
+
+    /** @brief Sparse matrix in CSR format (compressed sparse rows): for each row only the non-zero elements are stored,
+        with their column index. Used for pruned weights, the pattern (non-zero positions) never changes after creation.
+    */
+    class SparseMatrix {
+        protected:
+
+        /// @brief Columns
+        size_t _cols;
+
+        /// @brief Rows
+        size_t _rows;
+
+        /// @brief Index of the first element of each row in _values (size is rows + 1)
+        vector<uint32_t> _rowStart;
+
+        /// @brief Column index of each stored element
+        vector<uint32_t> _colIndex;
+
+        /// @brief Stored (non-zero) elements
+        vector<double> _values;
+
+        public:
+
+        /// @brief Build a CSR matrix from a dense one, keeping the non-zero elements.
+        /// @param dense Dense matrix
+        SparseMatrix(const Matrix& dense);
+
+        /// @brief Return row number
+        /// @return rows
+        const size_t& Rows() const;
+
+        /// @brief Return col number
+        /// @return cols
+        const size_t& Cols() const;
+
+        /// @brief Number of stored elements
+        /// @return non-zeros
+        size_t NonZeros() const;
+
+        /// @brief Fraction of elements not stored
+        /// @return Sparsity (0.0 to 1.0)
+        double Sparsity() const;
+
+        /// @brief Memory used by values, column indexes and row starts
+        /// @return Bytes
+        size_t MemoryUsage() const;
+
+        /// @brief Multiply current matrix by a vector
+        /// @param v vector
+        /// @return Pointer to resulting vector
+        unique_ptr<vector<double>> MultiplyVector(const vector<double>& v) const;
+
+        /// @brief Multiply current matrix by a vector, writing the result
+        /// @param x Input values (cols)
+        /// @param y Output values (rows)
+        void MultiplyVector(const double* x, double* y) const;
+
+        /// @brief Reload the stored elements from a dense matrix with same size. Dense elements outside the pattern are set to zero
+        /// so the dense matrix keeps the sparsity (useful after a training step).
+        /// @param dense Dense matrix
+        void Reload(Matrix& dense);
+
+        /// @brief Dense copy of this matrix
+        /// @return new matrix
+        unique_ptr<Matrix> ToDense() const;
+    };
+
+    /** @brief Weights storage format */
+    enum class WeightStorage {
+        /// @brief double (8 bytes)
+        Double,
+        /// @brief IEEE 754 half precision (2 bytes: 1 sign, 5 exponent, 10 mantissa bits), range +-65504
+        Half,
+        /// @brief bfloat16 (2 bytes: 1 sign, 8 exponent, 7 mantissa bits), same range as float
+        BFloat16
+    };
+
+    /** @brief Matrix stored in 16 bit floating point (Half or BFloat16), contiguous row major: a quarter of the memory and
+        memory traffic of a double matrix. Rows are decoded to float in a buffer, products are accumulated in double.
+    */
+    class HalfMatrix {
+        protected:
+
+        /// @brief Columns
+        size_t _cols;
+
+        /// @brief Rows
+        size_t _rows;
+
+        /// @brief Format
+        WeightStorage _format;
+
+        /// @brief Elements (row major)
+        unique_ptr<uint16_t[]> _values;
+
+        /// @brief Decode values to float (half through a lookup table)
+        /// @param src Encoded values
+        /// @param dst Decoded values
+        /// @param n Number of values
+        /// @param format WeightStorage::Half or WeightStorage::BFloat16
+        static void DecodeFloat(const uint16_t* src, float* dst, const size_t& n, const WeightStorage& format);
+
+        public:
+
+        /// @brief Build from a double matrix (rounded to nearest even)
+        /// @param m Matrix
+        /// @param format WeightStorage::Half or WeightStorage::BFloat16
+        HalfMatrix(const Matrix& m, const WeightStorage& format);
+
+        /// @brief Return row number
+        /// @return rows
+        const size_t& Rows() const;
+
+        /// @brief Return col number
+        /// @return cols
+        const size_t& Cols() const;
+
+        /// @brief Storage format
+        const WeightStorage& Format() const;
+
+        /// @brief Element (i,j) converted to double
+        double at(const size_t& i, const size_t& j) const;
+
+        /// @brief Memory used by elements
+        /// @return Bytes
+        size_t MemoryUsage() const;
+
+        /// @brief Encoded elements (row major)
+        const uint16_t* Values() const;
+
+        /// @brief Multiply current matrix by a vector, writing the result (accumulated in double)
+        /// @param x Input values (cols)
+        /// @param y Output values (rows)
+        void MultiplyVector(const double* x, double* y) const;
+
+        /// @brief Multiply encoded elements (row major, for example from a frozen model blob) by a vector, writing the result (accumulated in double)
+        /// @param values Encoded elements
+        /// @param rows Rows
+        /// @param cols Columns
+        /// @param format WeightStorage::Half or WeightStorage::BFloat16
+        /// @param x Input values (cols)
+        /// @param y Output values (rows)
+        static void MultiplyVector(const uint16_t* values, const size_t& rows, const size_t& cols, const WeightStorage& format, const double* x, double* y);
+
+        /// @brief Reload all the elements from a double matrix with same size (for example the master copy after a training step)
+        /// @param m Matrix
+        void Reload(const Matrix& m);
+
+        /// @brief Double copy of this matrix
+        /// @return new matrix
+        unique_ptr<Matrix> ToMatrix() const;
+
+        /// @brief Convert a float to IEEE half precision (round to nearest even, overflow to infinity)
+        static inline uint16_t FloatToHalf(const float& value) {
+            uint32_t f;
+            memcpy(&f, &value, sizeof(f));
+            const uint32_t sign = f & 0x80000000u;
+            f ^= sign;
+
+            uint16_t h;
+            if (f >= (143u << 23)) {
+                // Overflow to infinity, NaN stays NaN
+                h = (f > (255u << 23) ? 0x7E00 : 0x7C00);
+            }
+            else if (f < (113u << 23)) {
+                // Subnormal half: let the float adder round the mantissa
+                const uint32_t magicBits = 126u << 23;
+                float magic, shifted;
+                memcpy(&magic, &magicBits, sizeof(magic));
+                memcpy(&shifted, &f, sizeof(shifted));
+                shifted += magic;
+                memcpy(&f, &shifted, sizeof(f));
+                h = static_cast<uint16_t>(f - magicBits);
+            }
+            else {
+                // Normal: rebias exponent and round to nearest even
+                const uint32_t odd = (f >> 13) & 1;
+                f += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + odd;
+                h = static_cast<uint16_t>(f >> 13);
+            }
+
+            return h | static_cast<uint16_t>(sign >> 16);
+        }
+
+        /// @brief Convert IEEE half precision to float (exact)
+        static inline float HalfToFloat(const uint16_t& value) {
+            const uint32_t exponentMask = 0x7C00u << 13;
+            uint32_t f = (static_cast<uint32_t>(value) & 0x7FFF) << 13;
+            const uint32_t exponent = f & exponentMask;
+            f += (127u - 15u) << 23;
+
+            float result;
+            if (exponent == exponentMask) {
+                // Infinity or NaN
+                f += (128u - 16u) << 23;
+            }
+            else if (exponent == 0) {
+                // Zero or subnormal: renormalize with the float unit
+                const uint32_t magicBits = 113u << 23;
+                float magic;
+                memcpy(&magic, &magicBits, sizeof(magic));
+                f += 1u << 23;
+                memcpy(&result, &f, sizeof(result));
+                result -= magic;
+                memcpy(&f, &result, sizeof(f));
+            }
+
+            f |= (static_cast<uint32_t>(value) & 0x8000) << 16;
+            memcpy(&result, &f, sizeof(result));
+            return result;
+        }
+
+        /// @brief Convert a float to bfloat16 (round to nearest even)
+        static inline uint16_t FloatToBFloat16(const float& value) {
+            uint32_t f;
+            memcpy(&f, &value, sizeof(f));
+            if ((f & 0x7FFFFFFFu) > 0x7F800000u) return static_cast<uint16_t>((f >> 16) | 0x40);
+            f += 0x7FFF + ((f >> 16) & 1);
+            return static_cast<uint16_t>(f >> 16);
+        }
+
+        /// @brief Convert bfloat16 to float (exact)
+        static inline float BFloat16ToFloat(const uint16_t& value) {
+            const uint32_t f = static_cast<uint32_t>(value) << 16;
+            float result;
+            memcpy(&result, &f, sizeof(result));
+            return result;
+        }
+
+        /// @brief Encode values
+        /// @param src Source values
+        /// @param dst Encoded values
+        /// @param n Number of values
+        /// @param format WeightStorage::Half or WeightStorage::BFloat16
+        static void Encode(const double* src, uint16_t* dst, const size_t& n, const WeightStorage& format);
+
+        /// @brief Decode values
+        /// @param src Encoded values
+        /// @param dst Decoded values
+        /// @param n Number of values
+        /// @param format WeightStorage::Half or WeightStorage::BFloat16
+        static void Decode(const uint16_t* src, double* dst, const size_t& n, const WeightStorage& format);
     };
 }
 
@@ -0,0 +1,278 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_PIPELINE_H
+#define BRIAND_PIPELINE_H
+
+#include "BriandInclude.hxx"
+#include "BriandFCNN.hxx"
+#include "BriandInferenceModel.hxx"
+#include "BriandTrace.hxx"
+
+#ifndef BRIAND_AI_CACHE_LINE
+    #define BRIAND_AI_CACHE_LINE 64 // Cache line size: producer and consumer indexes of rings are kept on different lines
+#endif
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Lock-free single producer / single consumer ring of preallocated slots (capacity is a power of two).
+        The producer fills a slot in place (Acquire() then Publish()), the consumer reads it in place (Peek() then Release()):
+        while the consumer works on slot N the producer can already fill slot N+1, nothing is copied or allocated.
+        Exactly one thread (or task) may produce and one may consume. To let the producer drop the oldest value (Evict()) the
+        consumer must copy values out with TryPopShared() instead of Peek()/Release().
+    */
+    template <typename T>
+    class SpscRing {
+        protected:
+
+        /// @brief Slots
+        vector<T> _slots;
+
+        /// @brief Capacity - 1
+        size_t _mask;
+
+        /// @brief Next slot to publish (written by the producer only)
+        alignas(BRIAND_AI_CACHE_LINE) atomic<size_t> _head;
+
+        /// @brief Next slot to consume shifted left by one, lowest bit set while the consumer copies it out (see TryPopShared()).
+        /// Written by the consumer, and by the producer only in Evict()
+        alignas(BRIAND_AI_CACHE_LINE) atomic<size_t> _tail;
+
+        public:
+
+        /// @brief Build a ring
+        /// @param capacity Slots (rounded up to a power of two, at least 2)
+        /// @param prototype Initial value of each slot (for example a vector already sized)
+        SpscRing(const size_t& capacity, const T& prototype = T()) : _head(0), _tail(0) {
+            size_t n = 2;
+            while (n < capacity) n <<= 1;
+            this->_slots.assign(n, prototype);
+            this->_mask = n - 1;
+        }
+
+        /// @brief Slots
+        inline size_t Capacity() const { return this->_mask + 1; }
+
+        /// @brief Published slots not yet released (approximate when called by a third thread)
+        inline size_t Size() const { return this->_head.load(std::memory_order_acquire) - (this->_tail.load(std::memory_order_acquire) >> 1); }
+
+        /// @brief Producer: the free slot to fill, nullptr if the ring is full
+        inline T* Acquire() {
+            const size_t head = this->_head.load(std::memory_order_relaxed);
+            if (head - (this->_tail.load(std::memory_order_acquire) >> 1) > this->_mask) return nullptr;
+            return &this->_slots[head & this->_mask];
+        }
+
+        /// @brief Producer: publish the slot returned by Acquire()
+        inline void Publish() { this->_head.store(this->_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+        /// @brief Producer: copy a value in the ring
+        /// @return false if full
+        inline bool TryPush(const T& value) {
+            T* slot = this->Acquire();
+            if (slot == nullptr) return false;
+            *slot = value;
+            this->Publish();
+            return true;
+        }
+
+        /// @brief Producer: drop the oldest value to make room for a new one (the consumer must use TryPopShared())
+        /// @return false if the ring is empty or the consumer is copying the oldest value out (its slot is freed right after)
+        inline bool Evict() {
+            size_t tail = this->_tail.load(std::memory_order_acquire);
+            if ((tail & 1) != 0 || (tail >> 1) == this->_head.load(std::memory_order_relaxed)) return false;
+            return this->_tail.compare_exchange_strong(tail, tail + 2, std::memory_order_acq_rel, std::memory_order_acquire);
+        }
+
+        /// @brief Consumer: the oldest published slot, nullptr if the ring is empty
+        inline T* Peek() {
+            const size_t tail = this->_tail.load(std::memory_order_relaxed) >> 1;
+            if (tail == this->_head.load(std::memory_order_acquire)) return nullptr;
+            return &this->_slots[tail & this->_mask];
+        }
+
+        /// @brief Consumer: release the slot returned by Peek() to the producer
+        inline void Release() { this->_tail.store(this->_tail.load(std::memory_order_relaxed) + 2, std::memory_order_release); }
+
+        /// @brief Consumer: copy out the oldest value
+        /// @return false if empty
+        inline bool TryPop(T& value) {
+            T* slot = this->Peek();
+            if (slot == nullptr) return false;
+            value = *slot;
+            this->Release();
+            return true;
+        }
+
+        /// @brief Consumer: copy out the oldest value when the producer may Evict(). The slot is claimed first, so it cannot
+        /// be evicted and overwritten while it is copied, then released at once.
+        /// @return false if empty
+        inline bool TryPopShared(T& value) {
+            size_t tail = this->_tail.load(std::memory_order_acquire);
+            do {
+                if ((tail >> 1) == this->_head.load(std::memory_order_acquire)) return false;
+            } while (!this->_tail.compare_exchange_weak(tail, tail | 1, std::memory_order_acquire, std::memory_order_acquire));
+
+            value = this->_slots[(tail >> 1) & this->_mask];
+            this->_tail.store(tail + 2, std::memory_order_release);
+            return true;
+        }
+    };
+
+    /** @brief What the pipeline does with a new frame when the ring is full (inference slower than acquisition) */
+    enum class DropPolicy {
+        /// @brief The new frame is discarded (Push() returns false)
+        DropNewest,
+        /// @brief The oldest queued frame is discarded to make room for the new one (freshest results). 
+        /// The inference task copies each frame out of the ring instead of reading it in place.
+        DropOldest,
+        /// @brief The producer waits for a free slot (no frame lost, acquisition is slowed down)
+        Block
+    };
+
+    /** @brief A frame in the pipeline ring */
+    class PipelineFrame {
+        public:
+        /// @brief Input values
+        vector<double> Values;
+        /// @brief Progressive number
+        uint64_t Sequence;
+        /// @brief Publish time (esp_timer_get_time())
+        uint64_t Timestamp;
+    };
+
+    /** @brief Pipeline statistics (snapshot) */
+    class PipelineStatistics {
+        public:
+        /// @brief Frames pushed (published or dropped)
+        uint64_t Produced;
+        /// @brief Frames inferred
+        uint64_t Processed;
+        /// @brief Frames dropped (not inferred)
+        uint64_t Dropped;
+        /// @brief Maximum queue depth seen by the producer
+        size_t MaxDepth;
+        /// @brief Mean queue depth seen by the producer
+        double MeanDepth;
+        /// @brief Minimum latency from publish to end of inference (microseconds)
+        uint64_t MinLatency;
+        /// @brief Mean latency (microseconds)
+        double MeanLatency;
+        /// @brief Maximum latency (microseconds)
+        uint64_t MaxLatency;
+    };
+
+    /** @brief Pipelined inference: an acquisition task (the caller) pushes input frames in a lock-free SPSC ring, an inference task
+        (created with xTaskCreatePinnedToCore) runs FCNN::Predict() with its own context and hands results to a callback.
+        Acquisition of frame N+1 overlaps inference on frame N; under overload frames are handled by the DropPolicy.
+        The network must not be trained or modified while the pipeline runs.
+    */
+    class InferencePipeline {
+        protected:
+
+        /// @brief Network
+        const FCNN& _fcnn;
+
+        /// @brief Context of the inference task
+        unique_ptr<ExecutionContext> _context;
+
+        /// @brief Frames ring
+        SpscRing<PipelineFrame> _ring;
+
+        /// @brief Drop policy
+        DropPolicy _policy;
+
+        /// @brief Result callback (called by the inference task)
+        function<void(const PipelineFrame&, const vector<double>&)> _callback;
+
+        /// @brief Inference task is running
+        atomic<bool> _running;
+
+        /// @brief Set to stop the inference task
+        atomic<bool> _stop;
+
+        /// @brief Inference task is waiting for frames
+        atomic<bool> _sleeping;
+
+        /// @brief Lock and condition to wake the inference task (used only when it sleeps)
+        mutex _sleepLock;
+        condition_variable _wake;
+
+        /// @brief Next frame sequence
+        uint64_t _sequence;
+
+        /// @brief Statistics counters (producer side)
+        atomic<uint64_t> _produced, _published, _dropped, _depthSum;
+        atomic<size_t> _maxDepth;
+
+        /// @brief Statistics counters (consumer side)
+        atomic<uint64_t> _processed, _latencySum, _minLatency, _maxLatency;
+
+        /// @brief Inference task body
+        static void InferenceTask(void* pipeline);
+
+        /// @brief Infer queued frames until stopped
+        void Run();
+
+        public:
+
+        /// @brief Build a pipeline
+        /// @param fcnn Network (must be closed with the output layer)
+        /// @param capacity Ring slots (rounded up to a power of two)
+        /// @param policy Drop policy
+        InferencePipeline(const FCNN& fcnn, const size_t& capacity = 8, const DropPolicy& policy = DropPolicy::DropNewest);
+
+        /// @brief Stops the inference task
+        ~InferencePipeline();
+
+        /// @brief Set the result callback, called by the inference task for each inferred frame (before Start())
+        /// @param callback Callback receiving the frame and the outputs
+        void SetCallback(const function<void(const PipelineFrame&, const vector<double>&)>& callback);
+
+        /// @brief Start the inference task
+        /// @param core Core to pin the task (tskNO_AFFINITY for none)
+        /// @param stackSize Task stack size (bytes)
+        /// @param priority Task priority
+        void Start(const BaseType_t& core = tskNO_AFFINITY, const uint32_t& stackSize = 4096, const UBaseType_t& priority = 5);
+
+        /// @brief Stop the inference task after the frames already queued, waits for it
+        void Stop();
+
+        /// @brief Producer: push a frame (copied into the ring slot)
+        /// @param values Input values (network inputs)
+        /// @return false if dropped
+        bool Push(const vector<double>& values);
+
+        /// @brief Producer: free slot to fill in place, then call Publish(). nullptr if full and the policy is DropNewest (the frame is counted as dropped)
+        PipelineFrame* Acquire();
+
+        /// @brief Producer: publish the frame filled after Acquire()
+        void Publish();
+
+        /// @brief Queue depth
+        size_t Depth() const;
+
+        /// @brief Statistics
+        PipelineStatistics Statistics() const;
+    };
+}
+
+#endif
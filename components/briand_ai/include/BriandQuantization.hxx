@@ -0,0 +1,169 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_QUANTIZATION_H
+#define BRIAND_QUANTIZATION_H
+
+#include "BriandInclude.hxx"
+#include "BriandMath.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Affine int8 quantization: real = (q - ZeroPoint) * Scale, q in [-128, 127] */
+    class QuantizationParameters {
+        public:
+        /// @brief Scale
+        double Scale;
+        /// @brief Zero point (the int8 value of real 0)
+        int32_t ZeroPoint;
+
+        /// @brief Build parameters (scale 1, zero point 0)
+        QuantizationParameters();
+
+        /// @brief Parameters mapping [min, max] (extended to include 0, so 0 is exact) to [-128, 127]
+        /// @param min Minimum real value
+        /// @param max Maximum real value
+        /// @return Parameters
+        static QuantizationParameters FromRange(const double& min, const double& max);
+
+        /// @brief Quantize a value (rounded, saturated)
+        inline int8_t Quantize(const double& value) const {
+            const double q = round(value / this->Scale) + static_cast<double>(this->ZeroPoint);
+            return static_cast<int8_t>(q < -128.0 ? -128.0 : (q > 127.0 ? 127.0 : q));
+        }
+
+        /// @brief Dequantize a value
+        inline double Dequantize(const int32_t& q) const { return static_cast<double>(q - this->ZeroPoint) * this->Scale; }
+
+        /// @brief Fake quantization: the real value nearest to value that int8 can represent
+        inline double FakeQuantize(const double& value) const { return this->Dequantize(this->Quantize(value)); }
+    };
+
+    /** @brief Range observer for quantization aware training. Batches are single samples, so the range expands at once 
+        to a value outside it and shrinks towards the sample range with an exponential moving average (outliers fade away).
+    */
+    class QuantizationObserver {
+        public:
+        /// @brief Observed minimum
+        double Min;
+        /// @brief Observed maximum
+        double Max;
+        /// @brief True after the first observation
+        bool Initialized;
+
+        /// @brief Build an observer with no observations
+        QuantizationObserver();
+
+        /// @brief Observe values
+        /// @param values Values
+        /// @param n Number of values
+        /// @param momentum EMA momentum (weight of the current range when shrinking, 0.0 to 1.0)
+        void Observe(const double* values, const size_t& n, const double& momentum);
+
+        /// @brief Quantization parameters for the observed range
+        QuantizationParameters Parameters() const;
+
+        /// @brief Forget observations
+        void Reset();
+    };
+
+    /** @brief A dense layer of a QuantizedModel.
+        Input x (int8) and per-row symmetric int8 weights are accumulated in int32 with an int32 bias, the accumulator is
+        requantized to the int8 net value with a fixed point multiplier and the activation is a 256 entries table (any function).
+    */
+    class QuantizedLayer {
+        public:
+        /// @brief Number of inputs (previous layer neurons)
+        size_t Inputs;
+        /// @brief Number of outputs (layer neurons)
+        size_t Outputs;
+        /// @brief Weights, row major (Outputs rows, Inputs cols), zero point 0
+        vector<int8_t> Weights;
+        /// @brief Weights scale of each row
+        vector<double> WeightScales;
+        /// @brief Bias of each row, scale is Input.Scale * WeightScales[i]
+        vector<int32_t> Bias;
+        /// @brief Sum of the weights of each row (input zero point correction)
+        vector<int32_t> RowSums;
+        /// @brief Requantization multiplier of each row (Q31), Input.Scale * WeightScales[i] / Net.Scale = Multiplier * 2^(-Shift - 31)
+        vector<int32_t> Multipliers;
+        /// @brief Requantization right shift of each row (after the 31 bits of the multiplier)
+        vector<int32_t> Shifts;
+        /// @brief Input quantization
+        QuantizationParameters Input;
+        /// @brief Net value quantization
+        QuantizationParameters Net;
+        /// @brief Output (activated value) quantization
+        QuantizationParameters Output;
+        /// @brief Activation table: output int8 for each net int8 (index is net + 128)
+        int8_t Activation[256];
+        /// @brief Softmax output layer: net values are dequantized and normalized (no table)
+        bool Softmax;
+
+        /// @brief Split a real multiplier in a Q31 multiplier and a shift
+        /// @param value Real multiplier (> 0)
+        /// @param multiplier Q31 multiplier (2^30 to 2^31-1)
+        /// @param shift Right shift after the 31 bits (negative for multipliers >= 1: Predict() shifts left, saturating)
+        static void QuantizeMultiplier(const double& value, int32_t& multiplier, int32_t& shift);
+    };
+
+    /** @brief Integer (int8) FCNN exported by FCNN::Quantize() after quantization aware training (or a calibration). 
+        Only inputs are quantized and outputs dequantized, layers run in int8 with int32 accumulation.
+    */
+    class QuantizedModel {
+        protected:
+
+        /// @brief Layers (input excluded)
+        vector<QuantizedLayer> _layers;
+
+        /// @brief Ping-pong activation buffers
+        vector<int8_t> _buffers[2];
+
+        /// @brief Net values of the output layer (softmax)
+        vector<double> _net;
+
+        public:
+
+        /// @brief Build a model
+        /// @param layers Layers (input excluded)
+        QuantizedModel(vector<QuantizedLayer> layers);
+
+        /// @brief Number of inputs
+        size_t Inputs() const;
+
+        /// @brief Number of outputs
+        size_t Outputs() const;
+
+        /// @brief Layers with their scales and zero points (input excluded)
+        const vector<QuantizedLayer>& Layers() const;
+
+        /// @brief Propagate forward (not thread safe, buffers are in the model)
+        /// @param inputs Inputs
+        /// @return Output values (dequantized)
+        unique_ptr<vector<double>> Predict(const vector<double>& inputs);
+
+        /// @brief RAM used by the model: object, int8 weights, int32 bias and row data, tables and buffers
+        /// @return Bytes
+        size_t MemoryUsage() const;
+    };
+}
+
+#endif
@@ -0,0 +1,260 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_RNN_H
+#define BRIAND_RNN_H
+
+#include "BriandInclude.hxx"
+#include "BriandMath.hxx"
+#include "BriandMatrix.hxx"
+#include "BriandRandom.hxx"
+#include "BriandTrace.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Recurrent cell type */
+    enum class RecurrentCell {
+        /// @brief Long short-term memory: gates i, f, g, o and a cell state
+        LSTM,
+        /// @brief Gated recurrent unit: gates z, r, n (reset applied to the recurrent part of n, as PyTorch/cuDNN)
+        GRU
+    };
+
+    /** @brief Values of a recurrent layer timestep kept for backpropagation through time */
+    class RecurrentStepCache {
+        public:
+        /// @brief Input and previous hidden state, concatenated
+        vector<double> Concat;
+        /// @brief Gates (after activation)
+        vector<double> Gates;
+        /// @brief LSTM: previous cell state. GRU: recurrent part of the n gate (before the reset gate)
+        vector<double> Extra;
+        /// @brief LSTM: cell state
+        vector<double> Cell;
+        /// @brief Hidden state
+        vector<double> Hidden;
+    };
+
+    /** @brief A recurrent layer (LSTM or GRU) with persistent hidden state.
+        All the gate weights are fused in one matrix (gates * hidden rows, inputs + hidden cols) applied to [x, h] in one pass,
+        so a Step() costs O(hidden * (inputs + hidden)) whatever the history length.
+    */
+    class RecurrentLayer {
+        protected:
+
+        /// @brief Cell type
+        RecurrentCell _cell;
+
+        /// @brief Inputs
+        size_t _inputs;
+
+        /// @brief Hidden units
+        size_t _hidden;
+
+        /// @brief Fused gate weights: one block of hidden rows for each gate, cols are inputs then hidden
+        unique_ptr<Matrix> _weights;
+
+        /// @brief Gate bias (gates * hidden)
+        vector<double> _bias;
+
+        /// @brief GRU: bias of the recurrent part of the n gate (hidden)
+        vector<double> _recurrentBias;
+
+        /// @brief Hidden state
+        vector<double> _h;
+
+        /// @brief LSTM: cell state
+        vector<double> _c;
+
+        /// @brief Scratch: [x, h]
+        vector<double> _concat;
+
+        /// @brief Scratch: gates pre-activation
+        vector<double> _gates;
+
+        /// @brief GRU scratch: recurrent part of the n gate
+        vector<double> _nh;
+
+        /// @brief Training: weight gradients (same layout as the weights, flat), bias and recurrent bias gradients
+        vector<double> _weightsGrad, _biasGrad, _recurrentBiasGrad;
+
+        /// @brief Training: gate gradients of a timestep (GRU: followed by the recurrent part of the n gate)
+        vector<double> _gatesGrad;
+
+        /// @brief Training: gradient on [x, h] of a timestep
+        vector<double> _concatGrad;
+
+        friend class RecurrentNetwork;
+
+        public:
+
+        /// @brief Build a layer with random weights (Xavier uniform, LSTM forget bias 1)
+        /// @param cell Cell type
+        /// @param inputs Inputs
+        /// @param hidden Hidden units
+        /// @param seed Weights seed
+        RecurrentLayer(const RecurrentCell& cell, const size_t& inputs, const size_t& hidden, const uint64_t& seed);
+
+        /// @brief Cell type
+        inline const RecurrentCell& Cell() const { return this->_cell; }
+
+        /// @brief Inputs
+        inline size_t Inputs() const { return this->_inputs; }
+
+        /// @brief Hidden units (outputs)
+        inline size_t Hidden() const { return this->_hidden; }
+
+        /// @brief Number of gates (4 for LSTM, 3 for GRU)
+        inline size_t Gates() const { return (this->_cell == RecurrentCell::LSTM ? 4 : 3); }
+
+        /// @brief Fused gate weights
+        inline const Matrix& Weights() const { return *this->_weights.get(); }
+
+        /// @brief Hidden state
+        inline const vector<double>& State() const { return this->_h; }
+
+        /// @brief Advance one timestep
+        /// @param x Inputs
+        /// @param cache Values for backpropagation (nullptr for inference)
+        /// @return Hidden state (valid until the next Step())
+        const vector<double>& Step(const double* x, RecurrentStepCache* cache = nullptr);
+
+        /// @brief Zero the hidden (and cell) state
+        void Reset();
+
+        /// @brief Backpropagate one timestep, accumulating weight gradients
+        /// @param cache Values of the timestep
+        /// @param dh Loss gradient on the hidden state (from the layer above and from the next timestep)
+        /// @param dc LSTM: loss gradient on the cell state from the next timestep, updated to the previous timestep one (ignored for GRU)
+        /// @param dx Loss gradient on the inputs (result, inputs values, may be nullptr)
+        /// @param dhPrev Loss gradient on the previous hidden state (result, hidden values)
+        void Backward(const RecurrentStepCache& cache, const double* dh, double* dc, double* dx, double* dhPrev);
+
+        /// @brief Apply and zero the accumulated gradients
+        /// @param learningRate Learning rate
+        /// @param scale Gradient scale (for example clipping factor)
+        void ApplyGradients(const double& learningRate, const double& scale);
+
+        /// @brief Squared norm of the accumulated gradients
+        double GradientsSquaredNorm() const;
+
+        /// @brief Number of parameters
+        size_t Parameters() const;
+
+        /// @brief Memory used in bytes (gradient buffers included once allocated by training)
+        size_t MemoryUsage() const;
+    };
+
+    /** @brief Recurrent network: stacked LSTM/GRU layers and a dense output layer.
+        Step() advances one timestep (streaming inference, the state persists between calls), TrainSequence() trains on a 
+        sequence with truncated backpropagation through time.
+    */
+    class RecurrentNetwork {
+        protected:
+
+        /// @brief Inputs
+        size_t _inputs;
+
+        /// @brief Recurrent layers
+        vector<unique_ptr<RecurrentLayer>> _layers;
+
+        /// @brief Output weights (outputs rows, last hidden cols) and bias
+        unique_ptr<Matrix> _outWeights;
+        vector<double> _outBias;
+
+        /// @brief Output activation, its derivative from the output value (nullptr if not available), its derivative from the net value,
+        /// error function and derivative
+        ActivationFunction _outActivation;
+        ActivationFunction _outDerivative;
+        ActivationFunction _outDerivativeNet;
+        ErrorFunction _error;
+        ErrorFunction _errorDerivative;
+
+        /// @brief Output is softmax (with cross entropy)
+        bool _softmax;
+
+        /// @brief Output values of the current timestep
+        vector<double> _outputs;
+
+        /// @brief Output net values of the current timestep (training only, when the derivative needs them)
+        vector<double> _outputsNet;
+
+        /// @brief Weights seed
+        uint64_t _seed;
+
+        public:
+
+        /// @brief Build an empty network
+        /// @param inputs Inputs of each timestep
+        RecurrentNetwork(const size_t& inputs);
+
+        /// @brief Set the seed for random weights of the next layers
+        /// @param seed Seed
+        void SetSeed(const uint64_t& seed);
+
+        /// @brief Add a recurrent layer
+        /// @param hidden Hidden units
+        /// @param cell Cell type
+        void AddRecurrentLayer(const size_t& hidden, const RecurrentCell& cell);
+
+        /// @brief Add the output layer, closes the network. Softmax requires CrossEntropy.
+        /// @param outputs Outputs
+        /// @param activationFunc Activation function
+        /// @param activationDer Activation derivative
+        /// @param errorFunc Error function
+        /// @param errorFuncDer Error derivative
+        void AddOutputLayer(const size_t& outputs, const ActivationFunction& activationFunc, const ActivationFunction& activationDer, const ErrorFunction& errorFunc, const ErrorFunction& errorFuncDer);
+
+        /// @brief Recurrent layers
+        inline const vector<unique_ptr<RecurrentLayer>>& Layers() const { return this->_layers; }
+
+        /// @brief Advance one timestep (streaming inference)
+        /// @param x Inputs of the timestep
+        /// @return Outputs of the timestep (valid until the next Step())
+        const vector<double>& Step(const double* x);
+
+        /// @brief Advance one timestep (streaming inference)
+        /// @param x Inputs of the timestep
+        /// @return Outputs of the timestep (valid until the next Step())
+        const vector<double>& Step(const vector<double>& x);
+
+        /// @brief Zero the state of all layers
+        void Reset();
+
+        /// @brief Train on a sequence (starting from a zero state) with truncated backpropagation through time: the sequence is
+        /// split in chunks of truncation steps, gradients flow back within a chunk only and weights are updated after each chunk
+        /// @param inputs Inputs of each timestep
+        /// @param targets Targets of each timestep (same number of timesteps, empty for no target at that step)
+        /// @param learningRate Learning rate
+        /// @param truncation Timesteps of backpropagation
+        /// @param clip Maximum gradient norm for a chunk (0 for no clipping)
+        /// @return Mean error of the timesteps with a target
+        double TrainSequence(const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const double& learningRate, const size_t& truncation = 16, const double& clip = 5.0);
+
+        /// @brief Number of parameters
+        size_t Parameters() const;
+
+        /// @brief Memory used in bytes
+        size_t MemoryUsage() const;
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_RANDOM_H
+#define BRIAND_RANDOM_H
+
+#include "BriandInclude.hxx"
+
+#ifndef BRIAND_AI_RANDOM_SEED
+    #define BRIAND_AI_RANDOM_SEED 0x5EED // Default global seed (runs are reproducible unless Random::Seed() is called with a different value)
+#endif
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Weight initialization method (applied by Matrix::RandomizeWeights()) */
+    enum class WeightInit { 
+        /// @brief He for ReLU layers, Xavier/Glorot otherwise
+        Auto,
+        /// @brief Uniform between 0 and 1 (old default)
+        Uniform,
+        /// @brief Xavier/Glorot uniform: U(-sqrt(6/(in+out)), sqrt(6/(in+out))), for sigmoid/tanh/identity
+        Xavier,
+        /// @brief He/Kaiming normal: N(0, sqrt(2/in)), for ReLU
+        He
+    };
+
+    /** @brief Fast pseudo random generator (xoshiro256**). Not thread safe: use one generator for each thread (see ThreadLocal()).
+        Generators built with the same seed and stream always give the same sequence, on any platform.
+    */
+    class Random {
+        protected:
+
+        /// @brief Generator state
+        uint64_t _s[4];
+
+        /// @brief Spare normal value (Box-Muller gives two)
+        double _spare;
+
+        /// @brief True if _spare is valid
+        bool _hasSpare;
+
+        /// @brief Global seed
+        static atomic<uint64_t> _globalSeed;
+
+        /// @brief Global seed generation (thread streams are re-seeded when changed)
+        static atomic<uint64_t> _generation;
+
+        /// @brief Next thread stream number
+        static atomic<uint64_t> _nextStream;
+
+        static inline uint64_t Rotl(const uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        public:
+
+        /// @brief Build a generator
+        /// @param seed Seed
+        /// @param stream Stream number: generators with same seed and different stream give independent sequences
+        Random(const uint64_t& seed, const uint64_t& stream = 0);
+
+        /// @brief Next 64 random bits
+        inline uint64_t Next() {
+            const uint64_t result = Rotl(this->_s[1] * 5, 7) * 9;
+            const uint64_t t = this->_s[1] << 17;
+            this->_s[2] ^= this->_s[0];
+            this->_s[3] ^= this->_s[1];
+            this->_s[1] ^= this->_s[2];
+            this->_s[0] ^= this->_s[3];
+            this->_s[2] ^= t;
+            this->_s[3] = Rotl(this->_s[3], 45);
+            return result;
+        }
+
+        /// @brief Uniform value in [0, 1)
+        inline double Uniform() { return static_cast<double>(this->Next() >> 11) * 0x1.0p-53; }
+
+        /// @brief Normal value
+        /// @param mean Mean
+        /// @param stddev Standard deviation
+        double Normal(const double& mean = 0.0, const double& stddev = 1.0);
+
+        /// @brief Fill with uniform values in [low, high)
+        void FillUniform(double* data, const size_t& n, const double& low = 0.0, const double& high = 1.0);
+
+        /// @brief Fill with normal values
+        void FillNormal(double* data, const size_t& n, const double& mean = 0.0, const double& stddev = 1.0);
+
+        /// @brief Set the global seed (used by thread generators and as default seed of new networks). Thread generators restart.
+        /// @param seed Seed
+        static void Seed(const uint64_t& seed);
+
+        /// @brief The global seed
+        static uint64_t GlobalSeed();
+
+        /// @brief Generator of the calling thread (global seed, one stream for each thread in order of first use)
+        static Random& ThreadLocal();
+
+        /// @brief SplitMix64 step, used to derive seeds
+        static uint64_t SplitMix64(uint64_t& state);
+    };
+}
+
+#endif
@@ -31,6 +31,9 @@ namespace Briand::SimpleNN {
     // Early declaration of Synapsis class needed in Neuron.
     class Synapsis;
 
+    // Early declaration of ExecutionPlan class needed in NeuralNetwork.
+    class ExecutionPlan;
+
     // Define an activation function type as a pointer to function that returns a double
     // by taking input with
 
@@ -59,6 +62,9 @@ namespace Briand::SimpleNN {
         /// @param value Assigned initial value
         Neuron(const double& value);
 
+        /// @brief Graph topology version, changed by every ConnectTo() (compiled networks rebuild their plan when it changes)
+        static atomic<uint32_t> TopologyVersion;
+
         /// @brief Connect this neuron to other with given weight (other neuron will have one more input Synapsis)
         /// @param other The other neuron
         /// @param weight Synapsis weight. Default is 1.0
@@ -76,8 +82,17 @@ namespace Briand::SimpleNN {
         /** @brief Source neuron pointer */
         Neuron* Source;
 
-        /** @brief Connection weight. If this is an input, Weight must be always 1. */
+        /** @brief Connection weight. If this is an input, Weight must be always 1. 
+         * Change it with SetWeight(): a compiled network does not see a direct assignment.
+        */
         double Weight;
+
+        /// @brief Weights version, changed by every SetWeight() (compiled networks reload their weights when it changes)
+        static atomic<uint32_t> WeightsVersion;
+
+        /// @brief Change the weight
+        /// @param weight New weight
+        void SetWeight(const double& weight);
     };
 
     /** @brief A layer of neurons */
@@ -102,6 +117,9 @@ namespace Briand::SimpleNN {
 
         /// @brief Updates all layer's neurons values
         void UpdateNeurons();
+
+        /* The ExecutionPlan class needs the activation function */
+        friend class ExecutionPlan;
     }; 
 
     /// @brief An empty Neural Network, without layers, neurons and connections.
@@ -110,6 +128,9 @@ namespace Briand::SimpleNN {
     class NeuralNetwork {
         protected:
 
+        /// @brief Compiled execution plan (nullptr if network is not compiled)
+        unique_ptr<ExecutionPlan> _plan;
+
         public:
 
         /// @brief There is always an input
@@ -124,8 +145,86 @@ namespace Briand::SimpleNN {
         /// @brief Forward Propagation
         virtual void PropagateForward();
 
+        /// @brief Minimum synapsis to compile: below this the plan setup (gather, activation calls) costs more than the graph walk
+        static const size_t COMPILE_MIN_SYNAPSES = 32;
+
+        /// @brief Compile the neuron graph into a flat execution plan (weights are copied). PropagateForward() will then use the plan.
+        /// Graph edits are tracked: after ConnectTo() the plan is rebuilt, after Synapsis::SetWeight() its weights are reloaded 
+        /// (on the next PropagateForward()).
+        /// @return false if the network has less than COMPILE_MIN_SYNAPSES synapsis (not compiled, the graph is faster)
+        bool Compile();
+
+        /// @brief Drop the execution plan (graph weights are never overwritten by the plan).
+        void Decompile();
+
+        /// @brief Returns true if network is compiled
+        bool IsCompiled() const;
+
+        /// @brief Returns the execution plan (nullptr if not compiled)
+        ExecutionPlan* GetPlan() const;
+
         /// @brief Constructor
         NeuralNetwork();
+
+        virtual ~NeuralNetwork();
+    };
+
+    /// @brief A NeuralNetwork graph compiled to flat arrays (CSR format: one row for each computed neuron, 
+    /// neurons in topological order, source indexes and weights stored contiguously).
+    /// Neurons without inputs (input, bias or external neurons) are sources: their values are read from the graph before executing.
+    class ExecutionPlan {
+        protected:
+
+        /// @brief All the neurons in the plan: sources first, then computed neurons in topological order
+        vector<Neuron*> _neurons;
+
+        /// @brief Neuron values, same index as _neurons
+        vector<double> _values;
+
+        /// @brief Number of source neurons (at the beginning of _neurons)
+        size_t _sources;
+
+        /// @brief CSR row start for each computed neuron (size is computed neurons + 1)
+        vector<size_t> _rowStart;
+
+        /// @brief CSR column: the index in _values of each synapsis source
+        vector<size_t> _sourceIndex;
+
+        /// @brief CSR values: the weight of each synapsis
+        vector<double> _weights;
+
+        /// @brief Original synapsis, same index as _weights (for reload)
+        vector<Synapsis*> _synapses;
+
+        /// @brief Activation function for each computed neuron
+        vector<ActivationFunction> _activations;
+
+        /// @brief Neuron::TopologyVersion and Synapsis::WeightsVersion when built or reloaded
+        uint32_t _topologyVersion, _weightsVersion;
+
+        public:
+
+        /// @brief Compile the network graph. Throws runtime_error if graph has a cycle.
+        /// @param network The network
+        ExecutionPlan(const NeuralNetwork& network);
+
+        /// @brief Read source values from graph, calculate all the computed neurons and write their values back to the graph.
+        void Execute();
+
+        /// @brief Copy graph synapsis weights to plan (done automatically after Synapsis::SetWeight(), call it after a direct assignment)
+        void ReloadWeights();
+
+        /// @brief True if a ConnectTo() happened after the plan was built
+        bool IsTopologyStale() const;
+
+        /// @brief True if a Synapsis::SetWeight() happened after the plan was built or reloaded
+        bool AreWeightsStale() const;
+
+        /// @brief Number of computed neurons
+        size_t ComputedNeurons() const;
+
+        /// @brief Number of synapsis
+        size_t Synapses() const;
     };
 
     /// @brief Perceptron (one input layer, one output layer with single out, no hidden layers)
@@ -135,6 +234,7 @@ namespace Briand::SimpleNN {
         public:
 
         /// @brief Create Perceptron with specified inputs. All inputs will be connected to output automatically.
+        /// The network is not compiled: call Compile() for the flat execution plan (done only from COMPILE_MIN_SYNAPSES inputs).
         /// @param inputs Number of input neurons
         /// @param activationFunction Activation function to be used (pointer)
         Perceptron(const int& inputs, ActivationFunction activationFunction);
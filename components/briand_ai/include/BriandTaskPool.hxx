@@ -0,0 +1,121 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_TASKPOOL_H
+#define BRIAND_TASKPOOL_H
+
+#include "BriandInclude.hxx"
+#include "BriandTrace.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Persistent pool of worker threads, shared by library kernels that run in parallel.
+        Each worker is pinned to a core (with esp_pthread_cfg_t.pin_to_core, on ESP32 workers are pthreads/FreeRTOS tasks on core 0 and 1)
+        and has its own task deque: the owner takes tasks from the back, idle workers steal from the front of the others.
+    */
+    class TaskPool {
+        protected:
+
+        /// @brief Task deque of a worker
+        class WorkerQueue {
+            public:
+            /// @brief Queue lock
+            mutex Lock;
+            /// @brief Tasks
+            deque<function<void()>> Tasks;
+        };
+
+        /// @brief One queue for each worker
+        vector<unique_ptr<WorkerQueue>> _queues;
+
+        /// @brief Worker threads
+        vector<std::thread> _threads;
+
+        /// @brief Tasks queued and not yet started
+        atomic<size_t> _pending;
+
+        /// @brief Tasks submitted and not yet finished
+        atomic<size_t> _active;
+
+        /// @brief Next queue for tasks submitted from outside the pool (round robin)
+        atomic<size_t> _next;
+
+        /// @brief Set to stop workers
+        atomic<bool> _stop;
+
+        /// @brief Lock for sleeping workers
+        mutex _sleepLock;
+
+        /// @brief Wakes up sleeping workers
+        condition_variable _wake;
+
+        /// @brief Worker thread main loop
+        /// @param index Worker index
+        /// @param core Core to pin (tskNO_AFFINITY for no pinning)
+        void WorkerLoop(const size_t index, const int core);
+
+        /// @brief Stop and join the workers
+        void StopWorkers();
+
+        /// @brief Run one task: from own queue (back) or stolen from other queues (front).
+        /// @param index Queue to start with
+        /// @return true if a task has been run
+        bool RunOne(const size_t& index);
+
+        /// @brief Queue index of the calling thread (its own queue if it is a worker of this pool, otherwise round robin)
+        size_t CallerQueue();
+
+        public:
+
+        /// @brief Start the pool
+        /// @param workers Number of workers (0 = one for each core)
+        /// @param pin If true, worker i is pinned to core i (modulo cores)
+        TaskPool(const size_t& workers = 0, const bool& pin = true);
+
+        /// @brief Stop workers (queued tasks are discarded)
+        ~TaskPool();
+
+        /// @brief Shared pool used by library kernels, created on first use
+        /// @return The default pool
+        static TaskPool& Default();
+
+        /// @brief Number of workers
+        /// @return workers
+        size_t Workers() const;
+
+        /// @brief Queue a task
+        /// @param task Task to run
+        void Submit(function<void()> task);
+
+        /// @brief Wait until all submitted tasks are finished. The calling thread runs queued tasks while waiting.
+        void Wait();
+
+        /// @brief Run body(from, to) on chunks of [begin, end) in parallel and return when all chunks are done. 
+        /// The calling thread runs chunks too. Exceptions thrown by body are re-thrown (the first one).
+        /// @param begin Range begin
+        /// @param end Range end (excluded)
+        /// @param grain Minimum chunk size (0 = split range in one chunk for each worker)
+        /// @param body Function called for each chunk
+        void ParallelFor(const size_t& begin, const size_t& end, const size_t& grain, const function<void(size_t, size_t)>& body);
+    };
+}
+
+#endif
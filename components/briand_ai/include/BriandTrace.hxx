@@ -0,0 +1,179 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_TRACE_H
+#define BRIAND_TRACE_H
+
+#include "BriandInclude.hxx"
+
+#ifndef BRIAND_AI_TRACE
+    #define BRIAND_AI_TRACE 1 // Compile trace scopes (recording must be started anyway with Trace::Start())
+#endif
+
+#if BRIAND_AI_TRACE
+    #define BRIAND_TRACE_CONCAT_(a, b) a##b
+    #define BRIAND_TRACE_CONCAT(a, b) BRIAND_TRACE_CONCAT_(a, b)
+    /// @brief Record a scoped event named n (must be a string literal)
+    #define BRIAND_TRACE_SCOPE(n) Briand::TraceScope BRIAND_TRACE_CONCAT(_briand_trace_, __LINE__)(n)
+    /// @brief Record a scoped event named n (must be a string literal) with an integer argument
+    #define BRIAND_TRACE_SCOPE_ARG(n, a) Briand::TraceScope BRIAND_TRACE_CONCAT(_briand_trace_, __LINE__)(n, a)
+#else
+    #define BRIAND_TRACE_SCOPE(n)
+    #define BRIAND_TRACE_SCOPE_ARG(n, a)
+#endif
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief A recorded event: a named interval of time on a thread */
+    class TraceEvent {
+        public:
+        /// @brief Event name (string literal, never freed)
+        const char* Name;
+        /// @brief Begin timestamp (Trace::Now())
+        uint64_t Begin;
+        /// @brief End timestamp (Trace::Now())
+        uint64_t End;
+        /// @brief Optional argument (for example the layer index), negative if not set
+        long Arg;
+    };
+
+    /** @brief Fixed size ring of events written by one thread only (lock-free). When full the oldest events are overwritten. */
+    class TraceBuffer {
+        public:
+        /// @brief Events
+        vector<TraceEvent> Events;
+        /// @brief Number of events written (next write position is Written % size)
+        atomic<size_t> Written;
+        /// @brief Thread number (progressive, used as tid in the trace)
+        size_t ThreadNumber;
+        /// @brief Thread name
+        string ThreadName;
+
+        /// @brief Build a buffer
+        /// @param size Number of events
+        /// @param threadNumber Thread number
+        TraceBuffer(const size_t& size, const size_t& threadNumber);
+    };
+
+    /** @brief Timeline tracing. Events are recorded in a per-thread ring buffer and saved in Chrome trace JSON format 
+        (open with chrome://tracing or https://ui.perfetto.dev). Timestamps come from a monotonic clock.
+    */
+    class Trace {
+        protected:
+
+        /// @brief Recording enabled
+        static atomic<bool> _enabled;
+
+        /// @brief Events per thread buffer
+        static size_t _bufferSize;
+
+        /// @brief Buffers of all threads (owned here, so events survive the thread)
+        static vector<unique_ptr<TraceBuffer>> _buffers;
+
+        /// @brief Lock for _buffers (taken only when a thread records its first event and when saving)
+        static mutex _buffersLock;
+
+        /// @brief Buffer of the calling thread (created on first use)
+        static TraceBuffer* ThreadBuffer();
+
+        public:
+
+        /// @brief Monotonic timestamp (nanoseconds on Linux with steady_clock, microseconds on ESP32 with esp_timer)
+        /// @return timestamp
+        static inline uint64_t Now() {
+        #if defined(ESP_PLATFORM)
+            // The cycle counter is 32 bit and per core (tasks move between cores), esp_timer is global and 64 bit.
+            return static_cast<uint64_t>(esp_timer_get_time());
+        #else
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        #endif
+        }
+
+        /// @brief Now() ticks in one microsecond
+        /// @return ticks
+        static constexpr double TicksPerMicrosecond() {
+        #if defined(ESP_PLATFORM)
+            return 1.0;
+        #else
+            return 1000.0;
+        #endif
+        }
+
+        /// @brief True if recording
+        static inline bool IsEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+        /// @brief Start recording
+        /// @param eventsPerThread Ring buffer size for threads recording their first event from now
+        static void Start(const size_t& eventsPerThread = 4096);
+
+        /// @brief Stop recording (events are kept)
+        static void Stop();
+
+        /// @brief Remove all events (call when no thread is recording)
+        static void Clear();
+
+        /// @brief Set the name of the calling thread in the trace
+        /// @param name Thread name
+        static void SetThreadName(const char* name);
+
+        /// @brief Record an event on the calling thread
+        /// @param name Event name (string literal)
+        /// @param begin Begin timestamp
+        /// @param end End timestamp
+        /// @param arg Argument (negative if not set)
+        static void Record(const char* name, const uint64_t& begin, const uint64_t& end, const long& arg = -1);
+
+        /// @brief Write all the events in Chrome trace JSON format (call when no thread is recording)
+        /// @param out Output stream
+        static void Write(FILE* out);
+
+        /// @brief Save all the events in Chrome trace JSON format to a file
+        /// @param path File path
+        /// @return true if saved
+        static bool Save(const char* path);
+    };
+
+    /** @brief Records an event lasting as long as this object */
+    class TraceScope {
+        protected:
+        /// @brief Event name
+        const char* _name;
+        /// @brief Begin timestamp (0 if not recording)
+        uint64_t _begin;
+        /// @brief Argument
+        long _arg;
+
+        public:
+        /// @brief Begin the event
+        /// @param name Event name (string literal)
+        /// @param arg Argument (negative if not set)
+        inline TraceScope(const char* name, const long& arg = -1) : _name(name), _begin(0), _arg(arg) {
+            if (Trace::IsEnabled()) this->_begin = Trace::Now();
+        }
+
+        /// @brief End the event and record it
+        inline ~TraceScope() {
+            if (this->_begin != 0) Trace::Record(this->_name, this->_begin, Trace::Now(), this->_arg);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,142 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_TRAINER_H
+#define BRIAND_TRAINER_H
+
+#include "BriandInclude.hxx"
+#include "BriandRandom.hxx"
+#include "BriandFCNN.hxx"
+#include "BriandInferenceModel.hxx"
+#include "BriandLog.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Learning rate schedule (rate of epoch e, starting from rate r0) */
+    enum class LearningRateSchedule {
+        /// @brief r0
+        Constant,
+        /// @brief r0 * decay^(e / step) (integer division)
+        Step,
+        /// @brief r0 * decay^e
+        Exponential,
+        /// @brief r0 * (1 + cos(pi * e / maxEpochs)) / 2
+        Cosine
+    };
+
+    /** @brief Result of Trainer::Fit() */
+    class TrainResult {
+        public:
+        /// @brief Epochs run
+        size_t Epochs;
+        /// @brief Epoch with the best validation loss (0 is the first one)
+        size_t BestEpoch;
+        /// @brief Best validation loss (mean for each sample)
+        double BestValidationLoss;
+        /// @brief True if stopped early
+        bool StoppedEarly;
+        /// @brief Wall-clock time of the whole training (microseconds)
+        uint64_t Time;
+        /// @brief Wall-clock time until the end of the best epoch (microseconds), the time to convergence
+        uint64_t TimeToBest;
+        /// @brief Training loss of each epoch (mean for each sample)
+        vector<double> TrainLoss;
+        /// @brief Validation loss of each epoch (mean for each sample)
+        vector<double> ValidationLoss;
+    };
+
+    /** @brief Epoch-level training loop for FCNN: shuffles the samples each epoch (index permutation, samples are not copied),
+        evaluates the validation split on a background thread while the next epoch trains (on a frozen snapshot of the weights),
+        applies a learning rate schedule and stops early when the validation loss does not improve, restoring the best weights.
+    */
+    class Trainer {
+        protected:
+
+        /// @brief Network
+        FCNN& _fcnn;
+
+        /// @brief Initial learning rate
+        double _learningRate;
+
+        /// @brief Learning rate schedule
+        LearningRateSchedule _schedule;
+
+        /// @brief Decay factor (Step and Exponential schedules)
+        double _decay;
+
+        /// @brief Epochs for each step (Step schedule)
+        size_t _step;
+
+        /// @brief Epochs without improvement before stopping (0 = never stop early)
+        size_t _patience;
+
+        /// @brief Minimum decrease of the validation loss to be an improvement
+        double _minDelta;
+
+        /// @brief Fraction of samples for validation
+        double _validationSplit;
+
+        /// @brief Shuffle seed
+        uint64_t _seed;
+
+        /// @brief Mean loss of the model over the samples selected by indexes from..to-1
+        double Evaluate(const InferenceModel& model, const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const vector<size_t>& indexes, const size_t& from, const size_t& to) const;
+
+        public:
+
+        /// @brief Build a trainer (defaults: learning rate 0.1 constant, patience 10, validation split 0.2)
+        /// @param fcnn Network (must be closed with the output layer)
+        Trainer(FCNN& fcnn);
+
+        /// @brief Set the learning rate schedule
+        /// @param learningRate Initial learning rate
+        /// @param schedule Schedule
+        /// @param decay Decay factor (Step and Exponential)
+        /// @param step Epochs for each step (Step)
+        void SetLearningRate(const double& learningRate, const LearningRateSchedule& schedule = LearningRateSchedule::Constant, const double& decay = 0.5, const size_t& step = 10);
+
+        /// @brief Set early stopping
+        /// @param patience Epochs without improvement before stopping (0 = never stop early)
+        /// @param minDelta Minimum decrease of the validation loss to be an improvement
+        void SetEarlyStopping(const size_t& patience, const double& minDelta = 0.0);
+
+        /// @brief Set the validation split
+        /// @param fraction Fraction of samples for validation (0.0 to less than 1.0, 0 = validate on training samples)
+        void SetValidationSplit(const double& fraction);
+
+        /// @brief Set the shuffle seed (default Random::GlobalSeed())
+        void SetSeed(const uint64_t& seed);
+
+        /// @brief Learning rate of an epoch
+        /// @param epoch Epoch (0 is the first one)
+        /// @param maxEpochs Maximum epochs (Cosine)
+        double LearningRate(const size_t& epoch, const size_t& maxEpochs) const;
+
+        /// @brief Train. At the end the network has the weights of the best epoch.
+        /// @param inputs Inputs
+        /// @param targets Targets
+        /// @param maxEpochs Maximum epochs
+        /// @return Result
+        TrainResult Fit(const vector<vector<double>>& inputs, const vector<vector<double>>& targets, const size_t& maxEpochs);
+    };
+}
+
+#endif
@@ -0,0 +1,150 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifndef BRIAND_WINDOW_H
+#define BRIAND_WINDOW_H
+
+#include "BriandInclude.hxx"
+
+using namespace std;
+
+namespace Briand {
+
+    /** @brief Features kept for each channel of a SlidingWindow, in this order */
+    enum class WindowFeature {
+        /// @brief Mean of the window samples
+        Mean = 0,
+        /// @brief Variance (population) of the window samples
+        Variance = 1,
+        /// @brief Minimum
+        Min = 2,
+        /// @brief Maximum
+        Max = 3,
+        /// @brief Energy (sum of squares)
+        Energy = 4
+    };
+
+    /** @brief A read-only view of the current window and its features, valid until the next SlidingWindow::Push() */
+    class WindowView {
+        public:
+        /// @brief Window samples, oldest to newest, channels interleaved (Length * Channels values, contiguous)
+        const double* Samples;
+        /// @brief Window length (samples)
+        size_t Length;
+        /// @brief Channels
+        size_t Channels;
+        /// @brief Features, for each channel 5 values in WindowFeature order (Channels * 5 values, contiguous)
+        const double* Features;
+
+        /// @brief Number of sample values (Length * Channels)
+        inline size_t SamplesSize() const { return this->Length * this->Channels; }
+
+        /// @brief Number of feature values
+        inline size_t FeaturesSize() const { return this->Channels * 5; }
+
+        /// @brief A feature of a channel
+        inline double Feature(const size_t& channel, const WindowFeature& feature) const { return this->Features[channel * 5 + static_cast<size_t>(feature)]; }
+    };
+
+    /** @brief Streaming sliding window over multi-channel sensor samples, in a power-of-two ring.
+        Every Push() costs O(channels) whatever the window length: the ring is mirrored (each sample is written twice) so the window 
+        is always contiguous in memory, mean/variance/energy are updated adding the new sample and removing the leaving one, 
+        min/max come from monotonic queues (amortized O(1)). So that rounding errors do not build up, shadow sums of the current lap 
+        of the ring are accumulated too (adding only): every Length() pushes the lap covers exactly the window and replaces the sliding sums.
+        The window and its features can be passed to FCNN::Predict() / FCNN::SetInput() without copies.
+        One task writes and reads the window: to acquire from another task, move the samples with an SpscRing and push them here.
+    */
+    class SlidingWindow {
+        protected:
+
+        /// @brief Window length (power of two)
+        size_t _length;
+
+        /// @brief _length - 1
+        size_t _mask;
+
+        /// @brief Channels
+        size_t _channels;
+
+        /// @brief Mirrored ring: 2 * _length samples, sample i is stored at slots (i & _mask) and (i & _mask) + _length
+        vector<double> _ring;
+
+        /// @brief Samples pushed
+        uint64_t _count;
+
+        /// @brief Features (channels * 5)
+        vector<double> _features;
+
+        /// @brief Running mean and sum of squared differences from the mean (Welford) for each channel
+        vector<double> _mean, _m2;
+
+        /// @brief Running sum of squares for each channel
+        vector<double> _energy;
+
+        /// @brief Shadow mean, sum of squared differences and sum of squares of the samples pushed in the current lap of the ring, for each channel
+        vector<double> _lapMean, _lapM2, _lapEnergy;
+
+        /// @brief Monotonic queues of sample numbers for each channel (_length slots each): increasing values for min, decreasing for max
+        vector<uint64_t> _minQueue, _maxQueue;
+
+        /// @brief Queues head (oldest) and tail (next free) counters for each channel
+        vector<uint64_t> _minHead, _minTail, _maxHead, _maxTail;
+
+        /// @brief Value of a past sample still in the ring
+        inline double At(const uint64_t& sample, const size_t& channel) const { return this->_ring[(sample & this->_mask) * this->_channels + channel]; }
+
+        public:
+
+        /// @brief Build a window
+        /// @param length Window length in samples (rounded up to a power of two)
+        /// @param channels Values of each sample
+        SlidingWindow(const size_t& length, const size_t& channels = 1);
+
+        /// @brief Window length (samples)
+        inline size_t Length() const { return this->_length; }
+
+        /// @brief Channels
+        inline size_t Channels() const { return this->_channels; }
+
+        /// @brief Samples pushed since creation or Clear()
+        inline uint64_t Count() const { return this->_count; }
+
+        /// @brief True when the window has been filled once (before, missing samples are zeros and features use the pushed ones only)
+        inline bool Full() const { return this->_count >= this->_length; }
+
+        /// @brief Push a new sample, the oldest one leaves the window
+        /// @param sample Channels values
+        void Push(const double* sample);
+
+        /// @brief Push a new sample of a single channel window
+        /// @param value Value
+        inline void Push(const double& value) { this->Push(&value); }
+
+        /// @brief The current window and its features (valid until the next Push())
+        WindowView View() const;
+
+        /// @brief Empty the window
+        void Clear();
+
+        /// @brief Memory used in bytes
+        size_t MemoryUsage() const;
+    };
+}
+
+#endif
@@ -0,0 +1,400 @@
+
+/** Copyright (C) 2023 briand (https://github.com/briand-hub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Only one header is needed to use library.
+#include "BriandAI.hxx"
+
+#include "examples.hxx"
+
+#if !defined(ESP_PLATFORM)
+    #include <malloc.h>
+#endif
+
+// STL and library Namespeces
+using namespace std;
+using namespace Briand;
+
+/*
+    End-to-end workloads on procedurally generated datasets. Every dataset and network is built from fixed seeds,
+    so the report of two runs (or two library versions) on the same machine can be compared line by line.
+*/
+
+/// @brief Seed of all the datasets and networks
+static const uint64_t BENCHMARK_SEED = 2023;
+
+/** @brief A workload: dataset generator, network builder and training settings */
+class BenchmarkWorkload {
+    public:
+    /// @brief Name (used as key in the report)
+    const char* Name;
+    /// @brief Training samples
+    size_t TrainSamples;
+    /// @brief Test samples
+    size_t TestSamples;
+    /// @brief Learning rate
+    double LearningRate;
+    /// @brief Test accuracy for the time-to-accuracy metric
+    double TargetAccuracy;
+    /// @brief Maximum training epochs
+    size_t MaxEpochs;
+    /// @brief Dataset generator (samples, generator, inputs, targets)
+    function<void(size_t, Briand::Random&, vector<vector<double>>&, vector<vector<double>>&)> Generate;
+    /// @brief Network builder
+    function<unique_ptr<Briand::FCNN>()> Build;
+    /// @brief Convolutional feature extractor in front of the network (none if empty). Conv1D is not trainable: its weights stay fixed, only the network learns
+    function<unique_ptr<Briand::Conv1DNetwork>()> BuildFeatures;
+};
+
+/** @brief Dataset size: the ESP32 heap (about 300KB free) holds some tens of samples, 0 skips the workload */
+static constexpr size_t benchmark_samples(const size_t& full, const size_t& reduced) {
+#if defined(ESP_PLATFORM)
+    return reduced;
+#else
+    return full;
+#endif
+}
+
+/** @brief One-hot target */
+static vector<double> one_hot(const size_t& classes, const size_t& c) {
+    vector<double> t(classes, 0.0);
+    t[c] = 1.0;
+    return t;
+}
+
+/** @brief Draw a segment on a square image (values saturate at 1) */
+static void draw_segment(vector<double>& image, const int& side, double x0, double y0, const double& x1, const double& y1) {
+    const int steps = 2 * side;
+    for (int s = 0; s <= steps; s++) {
+        const double t = static_cast<double>(s) / static_cast<double>(steps);
+        const int x = static_cast<int>(round(x0 + t * (x1 - x0)));
+        const int y = static_cast<int>(round(y0 + t * (y1 - y0)));
+        if (x >= 0 && x < side && y >= 0 && y < side) image[y * side + x] = 1.0;
+    }
+}
+
+/** @brief MNIST-sized digits: 28x28, 10 classes. Each class is a fixed set of 3 strokes, samples are shifted, thinned and noisy */
+static void make_digits(size_t samples, Briand::Random& generator, vector<vector<double>>& inputs, vector<vector<double>>& targets) {
+    const int side = 28;
+
+    // Class prototypes: same strokes on every run
+    Briand::Random prototypes(BENCHMARK_SEED);
+    double strokes[10][3][4];
+    for (auto& c : strokes) for (auto& s : c) for (auto& v : s) v = 4.0 + prototypes.Uniform() * 20.0;
+
+    for (size_t i = 0; i < samples; i++) {
+        const size_t c = generator.Next() % 10;
+        const double dx = static_cast<double>(static_cast<int>(generator.Next() % 5) - 2);
+        const double dy = static_cast<double>(static_cast<int>(generator.Next() % 5) - 2);
+
+        vector<double> image(side * side, 0.0);
+        for (auto& s : strokes[c]) draw_segment(image, side, s[0] + dx, s[1] + dy, s[2] + dx, s[3] + dy);
+        for (auto& p : image) {
+            if (p > 0 && generator.Uniform() < 0.3) p = 0.0;
+            p += 0.3 * generator.Uniform();
+        }
+
+        inputs.push_back(std::move(image));
+        targets.push_back(one_hot(10, c));
+    }
+}
+
+/** @brief Sensor windows: 64 samples of a sine, square or sawtooth wave with random frequency, phase, amplitude and noise */
+static void make_sensor_windows(size_t samples, Briand::Random& generator, vector<vector<double>>& inputs, vector<vector<double>>& targets) {
+    const size_t window = 64;
+
+    for (size_t i = 0; i < samples; i++) {
+        const size_t c = generator.Next() % 3;
+        const double cycles = 2.0 + 4.0 * generator.Uniform();
+        const double phase = generator.Uniform();
+        const double amplitude = 0.5 + 0.5 * generator.Uniform();
+
+        vector<double> x(window);
+        for (size_t k = 0; k < window; k++) {
+            const double t = phase + cycles * static_cast<double>(k) / static_cast<double>(window);
+            const double f = t - floor(t);
+            double v = 0.0;
+            if (c == 0) v = sin(2.0 * M_PI * t);
+            else if (c == 1) v = (f < 0.5 ? 1.0 : -1.0);
+            else v = 2.0 * f - 1.0;
+            x[k] = amplitude * v + 0.15 * generator.Normal();
+        }
+
+        inputs.push_back(std::move(x));
+        targets.push_back(one_hot(3, c));
+    }
+}
+
+/** @brief Small images: 16x16 horizontal bar, vertical bar, diagonal or square ring at a random position, noisy */
+static void make_shapes(size_t samples, Briand::Random& generator, vector<vector<double>>& inputs, vector<vector<double>>& targets) {
+    const int side = 16;
+
+    for (size_t i = 0; i < samples; i++) {
+        const size_t c = generator.Next() % 4;
+        const double x = 2.0 + static_cast<double>(generator.Next() % 8);
+        const double y = 2.0 + static_cast<double>(generator.Next() % 8);
+        const double size = 3.0 + static_cast<double>(generator.Next() % 3);
+
+        vector<double> image(side * side, 0.0);
+        if (c == 0) draw_segment(image, side, x, y, x + size, y);
+        else if (c == 1) draw_segment(image, side, x, y, x, y + size);
+        else if (c == 2) draw_segment(image, side, x, y, x + size, y + size);
+        else {
+            draw_segment(image, side, x, y, x + size, y);
+            draw_segment(image, side, x + size, y, x + size, y + size);
+            draw_segment(image, side, x + size, y + size, x, y + size);
+            draw_segment(image, side, x, y + size, x, y);
+        }
+        for (auto& p : image) p += 0.25 * generator.Uniform();
+
+        inputs.push_back(std::move(image));
+        targets.push_back(one_hot(4, c));
+    }
+}
+
+/** @brief Convolutional features of a sample: the input is a sequence of timesteps (input channels values each), the features are the whole output sequence */
+static vector<double> benchmark_features(Briand::Conv1DNetwork& features, const vector<double>& input) {
+    const size_t channels = features.Layers().front()->InputChannels();
+    Briand::Matrix sequence(static_cast<int>(input.size() / channels), static_cast<int>(channels));
+    for (size_t t = 0; t < sequence.Rows(); t++) std::copy_n(input.data() + t * channels, channels, sequence[t]);
+
+    auto output = features.Forward(sequence);
+    vector<double> flat;
+    flat.reserve(output->Rows() * output->Cols());
+    for (size_t t = 0; t < output->Rows(); t++) flat.insert(flat.end(), (*output.get())[t], (*output.get())[t] + output->Cols());
+    return flat;
+}
+
+/** @brief Classification accuracy (argmax) */
+static double benchmark_accuracy(Briand::FCNN& fcnn, const vector<vector<double>>& inputs, const vector<vector<double>>& targets) {
+    size_t correct = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        auto y = fcnn.Predict(inputs[i]);
+        if (std::max_element(y->begin(), y->end()) - y->begin() == std::max_element(targets[i].begin(), targets[i].end()) - targets[i].begin()) correct++;
+    }
+    return static_cast<double>(correct) / static_cast<double>(inputs.size());
+}
+
+/** @brief Memory in use (Linux: resident set in bytes, ESP: free heap) */
+static size_t benchmark_memory() {
+#if defined(ESP_PLATFORM)
+    return esp_get_free_heap_size();
+#else
+    size_t pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f != NULL) {
+        if (fscanf(f, "%zu %zu", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/** @brief Peak memory of one workload: sampled at each phase against the value at its start */
+class BenchmarkMemory {
+    public:
+    /// @brief Memory at the start of the workload
+    size_t Start;
+    /// @brief Highest (Linux) or lowest (ESP) sample
+    size_t Extreme;
+
+    BenchmarkMemory() {
+#if !defined(ESP_PLATFORM)
+        // Give back the heap freed by the previous workloads, otherwise it is not counted again
+        malloc_trim(0);
+#endif
+        this->Start = benchmark_memory();
+        this->Extreme = this->Start;
+    }
+
+    /// @brief Take a sample
+    void Sample() {
+        const size_t now = benchmark_memory();
+#if defined(ESP_PLATFORM)
+        this->Extreme = std::min(this->Extreme, now);
+#else
+        this->Extreme = std::max(this->Extreme, now);
+#endif
+    }
+
+    /// @brief Peak memory taken by the workload, bytes
+    size_t Peak() const {
+        return (this->Extreme > this->Start ? this->Extreme - this->Start : this->Start - this->Extreme);
+    }
+};
+
+/** @brief Run a workload, append its lines to the report */
+static void run_workload(const BenchmarkWorkload& w, string& report) {
+    if (w.TrainSamples == 0) {
+        printf("%-14s skipped (does not fit this platform)\n", w.Name);
+        report += string(w.Name) + " skipped\n";
+        return;
+    }
+
+    BenchmarkMemory memory;
+    vector<vector<double>> inputs, targets, testInputs, testTargets;
+    Briand::Random generator(BENCHMARK_SEED, 1);
+    w.Generate(w.TrainSamples, generator, inputs, targets);
+    w.Generate(w.TestSamples, generator, testInputs, testTargets);
+
+    size_t datasetBytes = 0;
+    for (size_t i = 0; i < inputs.size(); i++) datasetBytes += (inputs[i].size() + targets[i].size()) * sizeof(double);
+    for (size_t i = 0; i < testInputs.size(); i++) datasetBytes += (testInputs[i].size() + testTargets[i].size()) * sizeof(double);
+
+    auto net = w.Build();
+    auto features = (w.BuildFeatures ? w.BuildFeatures() : nullptr);
+    size_t parameters = net->Parameters(), modelBytes = net->MemoryUsage();
+    if (features != nullptr) {
+        for (auto& layer : features->Layers()) parameters += layer->Weights().Rows() * layer->Weights().Cols() + layer->OutputChannels();
+        modelBytes += features->MemoryUsage();
+    }
+    memory.Sample();
+
+    // Training: throughput of each epoch, time (training only) to the target test accuracy
+    uint64_t trainTime = 0, timeToAccuracy = 0;
+
+    // Fixed feature extractor: the training set goes through it once (counted as training time), the test set is kept raw for the latency
+    vector<vector<double>> testFeatures;
+    if (features != nullptr) {
+        const uint64_t start = esp_timer_get_time();
+        for (auto& x : inputs) x = benchmark_features(*features.get(), x);
+        trainTime += esp_timer_get_time() - start;
+        for (auto& x : testInputs) testFeatures.push_back(benchmark_features(*features.get(), x));
+    }
+    const auto& testSet = (features != nullptr ? testFeatures : testInputs);
+    size_t epochs = 0, epochsToAccuracy = 0;
+    double accuracy = 0.0;
+    vector<size_t> order(inputs.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    Briand::Random shuffle(BENCHMARK_SEED, 2);
+
+    while (epochs < w.MaxEpochs) {
+        for (size_t i = order.size() - 1; i > 0; i--) std::swap(order[i], order[shuffle.Next() % (i + 1)]);
+
+        const uint64_t start = esp_timer_get_time();
+        for (auto k : order) net->Train(inputs[k], targets[k], w.LearningRate);
+        trainTime += esp_timer_get_time() - start;
+        epochs++;
+        memory.Sample();
+
+        accuracy = benchmark_accuracy(*net.get(), testSet, testTargets);
+        if (epochsToAccuracy == 0 && accuracy >= w.TargetAccuracy) {
+            epochsToAccuracy = epochs;
+            timeToAccuracy = trainTime;
+            break;
+        }
+    }
+
+    // Inference latency percentiles, one sample at a time
+    vector<uint64_t> latency;
+    for (size_t i = 0; i < testInputs.size(); i++) {
+        const uint64_t start = esp_timer_get_time();
+        if (features != nullptr) net->Predict(benchmark_features(*features.get(), testInputs[i]));
+        else net->Predict(testInputs[i]);
+        latency.push_back(esp_timer_get_time() - start);
+    }
+    memory.Sample();
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&latency](const double& p) { return static_cast<unsigned long>(latency[static_cast<size_t>(p * static_cast<double>(latency.size() - 1))]); };
+
+    char line[256];
+    auto add = [&report, &line, &w](const char* metric, const string& value) {
+        snprintf(line, sizeof(line), "%-14s %-26s %s\n", w.Name, metric, value.c_str());
+        report += line;
+        printf("%s", line);
+    };
+    char value[64];
+    snprintf(value, sizeof(value), "%lu", static_cast<unsigned long>(parameters));                                 add("parameters", value);
+    snprintf(value, sizeof(value), "%.1lf", static_cast<double>(epochs * inputs.size()) * 1e6 / static_cast<double>(trainTime)); add("train_samples_per_s", value);
+    snprintf(value, sizeof(value), "%lu", static_cast<unsigned long>(epochs));                                     add("epochs", value);
+    snprintf(value, sizeof(value), "%.3lf", accuracy);                                                             add("test_accuracy", value);
+    if (epochsToAccuracy > 0) {
+        snprintf(value, sizeof(value), "%lu (%lu epochs)", static_cast<unsigned long>(timeToAccuracy), static_cast<unsigned long>(epochsToAccuracy));
+        add("time_to_accuracy_us", value);
+    }
+    else add("time_to_accuracy_us", "not reached");
+    snprintf(value, sizeof(value), "%lu", percentile(0.5));                                                        add("predict_p50_us", value);
+    snprintf(value, sizeof(value), "%lu", percentile(0.9));                                                        add("predict_p90_us", value);
+    snprintf(value, sizeof(value), "%lu", percentile(0.99));                                                       add("predict_p99_us", value);
+    snprintf(value, sizeof(value), "%lu", static_cast<unsigned long>(modelBytes));                                 add("model_memory_bytes", value);
+    snprintf(value, sizeof(value), "%lu", static_cast<unsigned long>(datasetBytes));                               add("dataset_bytes", value);
+    snprintf(value, sizeof(value), "%lu", static_cast<unsigned long>(memory.Peak()));
+#if defined(ESP_PLATFORM)
+    add("peak_heap_bytes", value);
+#else
+    add("peak_rss_delta_bytes", value);
+#endif
+}
+
+/** @brief Workload benchmark suite */
+void benchmark_suite() {
+    printf("\n\n");
+    printf("***********************************************************\n");
+    printf("********************* WORKLOAD SUITE **********************\n\n");
+
+    string report = "briand_ai benchmark report 1\n";
+    report += "machine " + Briand::KernelProfile::Signature() + "\n";
+    report += "seed " + to_string(BENCHMARK_SEED) + "\n";
+    printf("%s", report.c_str());
+
+    vector<BenchmarkWorkload> workloads = {
+        // MNIST-sized MLP (not on ESP32: its 784x128 weights alone take 800KB)
+        { "digits784", benchmark_samples(600, 0), benchmark_samples(200, 0), 0.05, 0.90, 8, make_digits, [] {
+            auto net = make_unique<Briand::FCNN>();
+            net->SetSeed(BENCHMARK_SEED);
+            net->AddInputLayer(784);
+            net->AddHiddenLayer(128, Briand::Math::ReLU, Briand::Math::DeReLU);
+            net->AddOutputLayer(10, Briand::Math::Softmax, Briand::Math::DeSoftmax, Briand::Math::CrossEntropy, Briand::Math::DeCrossEntropy);
+            return net;
+        } },
+        // 1D sensor window classification
+        { "sensor64", benchmark_samples(1200, 120), benchmark_samples(200, 40), 0.02, 0.75, 30, make_sensor_windows, [] {
+            auto net = make_unique<Briand::FCNN>();
+            net->SetSeed(BENCHMARK_SEED);
+            net->AddInputLayer(64);
+            net->AddHiddenLayer(64, Briand::Math::Tanh, Briand::Math::DeTanh);
+            net->AddOutputLayer(3, Briand::Math::Softmax, Briand::Math::DeSoftmax, Briand::Math::CrossEntropy, Briand::Math::DeCrossEntropy);
+            return net;
+        } },
+        // Small image classification, CNN: convolution over the image rows (16 pixels channels), dense head on the 16x16 feature map
+        { "shapes16", benchmark_samples(600, 32), benchmark_samples(200, 16), 0.05, 0.90, 20, make_shapes, [] {
+            auto net = make_unique<Briand::FCNN>();
+            net->SetSeed(BENCHMARK_SEED);
+            net->AddInputLayer(256);
+            net->AddHiddenLayer(32, Briand::Math::ReLU, Briand::Math::DeReLU);
+            net->AddOutputLayer(4, Briand::Math::Softmax, Briand::Math::DeSoftmax, Briand::Math::CrossEntropy, Briand::Math::DeCrossEntropy);
+            return net;
+        }, [] {
+            auto features = make_unique<Briand::Conv1DNetwork>(16);
+            features->SetSeed(BENCHMARK_SEED);
+            features->AddLayer(16, 3, 1, Briand::Math::ReLU);
+            return features;
+        } }
+    };
+
+    for (auto& w : workloads) run_workload(w, report);
+
+#if !defined(ESP_PLATFORM)
+    FILE* f = fopen("briand_benchmarks.txt", "w");
+    if (f != NULL) {
+        fprintf(f, "%s", report.c_str());
+        fclose(f);
+        printf("Report saved to briand_benchmarks.txt\n");
+    }
+#endif
+
+    printf("***********************************************************\n\n\n");
+}
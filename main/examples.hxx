@@ -26,6 +26,9 @@
     /** @brief Performance test */
     void performance_test();
 
+    /** @brief End-to-end workload benchmark suite (synthetic datasets, reproducible report) */
+    void benchmark_suite();
+
     /** @brief Example project 1: OR port with NN */
     void example_1();
 
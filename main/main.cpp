@@ -25,6 +25,9 @@ extern "C" void app_main(void)
 
     performance_test();
 
+    // Reduced datasets on ESP32 (see benchmark_samples())
+    benchmark_suite();
+
     example_1();
     example_2();
     example_3();